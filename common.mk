@@ -1,2 +1,2 @@
-AM_CXXFLAGS = -Wall -Wextra -pedantic -std=c++11
+AM_CXXFLAGS = -Wall -Wextra -pedantic -std=c++11 -pthread
 AM_CPPFLAGS = -D_GNU_SOURCE @AM_CPPFLAGS@
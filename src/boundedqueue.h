@@ -0,0 +1,148 @@
+#ifndef BOUNDEDQUEUE_H
+    #define BOUNDEDQUEUE_H
+
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace Pdfsearch {
+    /** A blocking FIFO queue with a maximum size for passing work between
+     * threads.
+     * Example usage:
+     * @code
+       Pdfsearch::BoundedQueue<std::string> q(8);
+       // Producer.
+       q.push("a.pdf");
+       q.close();
+       // Consumer.
+       std::string file;
+       while (q.pop(file))
+           // ...
+       @endcode
+     * @note The class is non-copyable.
+     */
+    template<typename T>
+    class BoundedQueue {
+    private:
+        std::deque<T> items;
+        const size_t capacity;
+        bool closed;
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+    public:
+        /** Constructor.
+         * @param capacity Maximum number of items in the queue, > 0.
+         */
+        explicit BoundedQueue(size_t capacity) :
+            capacity(capacity), closed(false) {
+        };
+
+        /** Non-copyable. */
+        BoundedQueue(const BoundedQueue& other) = delete;
+        /** Non-copyable. */
+        BoundedQueue& operator=(const BoundedQueue& other) = delete;
+        /** Non-copyable. */
+        BoundedQueue(BoundedQueue&& other) = delete;
+        /** Non-copyable. */
+        BoundedQueue& operator=(BoundedQueue&& other) = delete;
+
+        /** Add an item to the queue.
+         * Blocks while the queue is full.
+         * @param item Item to add.
+         * @return False if the queue is closed and the item wasn't added,
+         * true otherwise.
+         */
+        bool
+        push(T item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this] {
+                return closed || items.size() < capacity;
+            });
+            if (closed)
+                return false;
+
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+
+            return true;
+        };
+
+        /** Remove an item from the queue.
+         * Blocks while the queue is empty and not closed.
+         * @param item Removed item is moved here.
+         * @return False if the queue is closed and empty, true otherwise.
+         */
+        bool
+        pop(T& item) {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty())
+                return false;
+
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+
+            return true;
+        };
+
+        /** Remove an item from the queue.
+         * Blocks while the queue is empty and not closed, at most @p timeout.
+         * @param item Removed item is moved here.
+         * @param timeout Maximum time to wait.
+         * @return False if the queue is closed and empty or on timeout, true
+         * otherwise. Use isDrained() to find out which.
+         */
+        template<typename Rep, typename Period>
+        bool
+        pop(T& item, const std::chrono::duration<Rep, Period>& timeout) {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait_for(lock, timeout, [this] {
+                return closed || !items.empty();
+            });
+            if (items.empty())
+                return false;
+
+            item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+
+            return true;
+        }
+
+        /** Check whether the queue is closed and empty.
+         * @return True if no more items can be popped.
+         */
+        bool
+        isDrained() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return closed && items.empty();
+        };
+
+        /** Close the queue.
+         * No more items can be added, remaining items can still be popped.
+         */
+        void
+        close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            notFull.notify_all();
+            notEmpty.notify_all();
+        };
+
+        /** Close the queue and discard remaining items. */
+        void
+        abort() {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            items.clear();
+            notFull.notify_all();
+            notEmpty.notify_all();
+        };
+    };
+}
+
+#endif // BOUNDEDQUEUE_H
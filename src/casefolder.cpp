@@ -0,0 +1,64 @@
+#include "casefolder.h"
+#include <stdexcept>
+#include <unicode/bytestream.h>
+#include <unicode/normalizer2.h>
+#include <unicode/utypes.h>
+
+static std::string
+joinHyphenated(const std::string& text);
+
+static bool
+isSpace(char c);
+
+std::string
+Pdfsearch::CaseFolder::fold(const std::string& text) {
+    UErrorCode error = U_ZERO_ERROR;
+    const icu::Normalizer2* normalizer =
+        icu::Normalizer2::getNFKCCasefoldInstance(error);
+    if (U_FAILURE(error))
+        throw std::runtime_error(u_errorName(error));
+
+    const std::string joined(joinHyphenated(text));
+    std::string folded;
+    folded.reserve(joined.size());
+    icu::StringByteSink<std::string> sink(&folded);
+    normalizer->normalizeUTF8(0, joined, sink, nullptr, error);
+    if (U_FAILURE(error))
+        throw std::runtime_error(u_errorName(error));
+
+    return folded;
+}
+
+/* A hyphen after a word, followed by a line break, is removed together with
+ * the whitespace around the line break. */
+static std::string
+joinHyphenated(const std::string& text) {
+    std::string joined;
+    joined.reserve(text.size());
+    const size_t size = text.size();
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] == '-' && i > 0 && !isSpace(text[i - 1]) &&
+                text[i - 1] != '-') {
+            size_t next = i + 1;
+            while (next < size && (text[next] == ' ' || text[next] == '\t'))
+                next++;
+            if (next < size && (text[next] == '\n' || text[next] == '\r')) {
+                while (next < size && isSpace(text[next]))
+                    next++;
+                if (next < size) {
+                    i = next - 1;
+                    continue;
+                }
+            }
+        }
+        joined += text[i];
+    }
+
+    return joined;
+}
+
+static bool
+isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+        c == '\r';
+}
@@ -0,0 +1,27 @@
+#ifndef CASEFOLDER_H
+    #define CASEFOLDER_H
+
+#include <string>
+
+namespace Pdfsearch {
+    /** A class to fold text for case-insensitive search in any script.
+     * Pages are stored folded and queries are folded the same way, so
+     * folded texts can be compared byte by byte.
+     */
+    class CaseFolder {
+    public:
+        /** Fold a text.
+         * Words broken to two lines with a hyphen are joined, and the text
+         * is normalized with Unicode NFKC_Casefold, which folds case,
+         * replaces compatibility characters like ligatures and removes
+         * ignorable characters like soft hyphens.
+         * @param text UTF-8 text. Invalid sequences are kept as they are.
+         * @return Folded UTF-8 text.
+         * @throws std::runtime_error if ICU fails.
+         */
+        static std::string
+        fold(const std::string& text);
+    };
+}
+
+#endif // CASEFOLDER_H
@@ -1,19 +1,157 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
-#include <boost/regex.hpp>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <system_error>
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
 #include "database.h"
 #include "database_error.h"
+#include "casefolder.h"
 #include "options.h"
+#include "levenshtein.h"
+#include "queryparser.h"
+#include "regexp.h"
+#include "snippet.h"
+#include "topk.h"
+#include "workerprocess.h"
+#include "walker.h"
+
+/* Sizes of the indexing queues per extraction job. Extracted texts are kept
+ * few, a pdf can have thousands of pages. */
+static const size_t FILES_PER_JOB = 16;
+static const size_t TEXTS_PER_JOB = 2;
+
+/* Pages inserted with one execution of a multi-row insert. Every row binds
+ * three parameters, SQLite allows at least 999. */
+static const int PAGES_PER_INSERT = 64;
+
+/* Version of the schema, stored in PRAGMA user_version. Databases with an
+ * older version are migrated when they are used. Version 1 added
+ * Pdfs.pages, version 2 PlainTexts.folded_text and version 3
+ * Pdfs.text_length. */
+static const int SCHEMA_VERSION = 3;
+
+static const char* const CREATE_INDEXES =
+    u8"create index if not exists last_modified_index on Pdfs(last_modified);"
+    u8"create index if not exists pdfs_id_index       on PlainTexts(pdfs_id);";
+
+/* FTS5 tables indexing the pages. The word index of the text is used by
+ * full-text queries, the trigram index of the folded text finds candidate
+ * pages for LIKE queries. */
+static const char* const FULL_TEXT_INDEX = "PageIndex";
+static const char* const FULL_TEXT_COLUMN = "plain_text";
+static const char* const FULL_TEXT_TOKENIZER = "unicode61";
+/* The term dictionary of the full-text index, a temporary table. */
+static const char* const FULL_TEXT_TERMS = "PageIndexTerms";
+static const char* const SUBSTRING_INDEX = "PageTrigrams";
+static const char* const SUBSTRING_COLUMN = "folded_text";
+static const char* const SUBSTRING_TOKENIZER = "trigram";
+
+/* Shortest run of characters between wildcards in a LIKE pattern, which
+ * gives a trigram to look up. */
+static const int MIN_TRIGRAM_LITERAL = 3;
+
+/* Maximum number of words in a snippet of a full-text query, FTS5 allows
+ * 64. */
+static const int MAX_SNIPPET_WORDS = 64;
+
+/* Parameters of BM25, the same as FTS5 uses. */
+static const double BM25_K1 = 1.2;
+static const double BM25_B = 0.75;
+
+/* How often the writer checks for a stop request while waiting for texts. */
+static const std::chrono::milliseconds STOP_POLL_INTERVAL(100);
+
+/* A result of a query sorted by relevance. Of results with the same score,
+ * the one found first is more relevant. */
+struct RankedResult {
+    double score;
+    size_t order;
+    Pdfsearch::QueryResult result;
+};
+
+/* Errors are printed from the walker, the extraction and the writer threads. */
+static std::mutex errorMutex;
+
+/* Set by Database::requestStop(), possibly from a signal handler. */
+static std::atomic<bool> stopRequested(false);
+
+static void
+printError(const std::exception& e);
+
+static std::vector<std::string>
+readPages(const Pdfsearch::Pdf& doc);
+
+static std::vector<std::string>
+foldPages(const std::vector<std::string>& pages);
+
+static void
+insertPages(const std::vector<std::string>& pages,
+    const std::vector<std::string>& folded, sqlite3_int64 pdfId,
+    const Pdfsearch::Statement& insertPage,
+    const Pdfsearch::Statement& insertManyPages);
+
+static sqlite3_int64
+textLength(const std::vector<std::string>& texts);
+
+static std::string
+statementSql(Pdfsearch::Database::statement_key key);
 
 static void
-insertPages(const Pdfsearch::Pdf& doc, const Pdfsearch::Statement& s);
+foldFunction(sqlite3_context* context, int argc, sqlite3_value** argv);
 
 static int
 numberOfRowsCb(void* rows, int columns, char** result, char** columnName);
 
-Pdfsearch::Database::Database(const std::string& file) :
+static std::string
+createTextIndexSql(const std::string& table, const std::string& column,
+    const std::string& tokenizer);
+
+static std::string
+dropTextIndexTriggersSql(const std::string& table);
+
+static int
+longestLiteral(const std::string& pattern);
+
+static int
+sqlLimit(int matches);
+
+static std::string
+orderBy(const std::string& sort, bool files);
+
+static std::string
+rowOrder(bool trigrams);
+
+static double
+bm25(int frequency, size_t length, double averageLength);
+
+static bool
+lessRelevant(const RankedResult& a, const RankedResult& b);
+
+static void
+assign(std::string& s, boost::string_view value);
+
+/* Rows of the queries reading pages: file, text or snippet, page, pages and
+ * folded text. Columns which aren't needed are NULL. */
+typedef Pdfsearch::ResultRows<boost::string_view,
+    boost::optional<boost::string_view>, boost::optional<int>,
+    boost::optional<int>, boost::optional<boost::string_view>> page_rows;
+
+static page_rows
+pageRows(const Pdfsearch::Statement& s);
+
+Pdfsearch::Database::Database(const std::string& file,
+        const DatabaseSettings& settings) :
     file(file),
-    db(nullptr) {
+    settings(settings),
+    db(nullptr),
+    migrated(false) {
     open();
 }
 
@@ -28,13 +166,34 @@ Pdfsearch::Database::~Database() {
 
 void
 Pdfsearch::Database::open() {
+    migrated = false;
     int result = sqlite3_open(file.c_str(), &db);
     if (result != SQLITE_OK)
         throw DatabaseError(result, sqlite3_errmsg(db));
 
+    result = sqlite3_busy_timeout(db, settings.busyTimeout);
+    if (result != SQLITE_OK)
+        throw DatabaseError(result, sqlite3_errmsg(db));
+
+    result = sqlite3_create_function(db, "fold", 1,
+        SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, foldFunction, nullptr,
+        nullptr);
+    if (result != SQLITE_OK)
+        throw DatabaseError(result, sqlite3_errmsg(db));
+
+    std::string sql("PRAGMA foreign_keys = ON;"
+        "PRAGMA wal_autocheckpoint = " +
+        std::to_string(settings.walAutocheckpoint) + ";");
+    if (settings.mmapSize > 0)
+        sql += "PRAGMA mmap_size = " + std::to_string(settings.mmapSize) + ";";
+    if (settings.journalMode == "delete" || settings.journalMode == "wal")
+        sql += "PRAGMA journal_mode = " + settings.journalMode + ";";
+    else if (!settings.journalMode.empty())
+        throw DatabaseError("unknown journal mode '" + settings.journalMode +
+            "'");
+
     char* errmsg = nullptr;
-    result = sqlite3_exec(db, "PRAGMA foreign_keys = ON;", nullptr, nullptr,
-        &errmsg);
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errmsg);
     if (result != SQLITE_OK) {
         std::string error(errmsg);
         sqlite3_free(errmsg);
@@ -43,13 +202,18 @@ Pdfsearch::Database::open() {
 }
 
 void
-Pdfsearch::Database::open(const std::string& file) {
+Pdfsearch::Database::open(const std::string& file,
+        const DatabaseSettings& settings) {
     this->file = file;
+    this->settings = settings;
     open();
 }
 
 void
 Pdfsearch::Database::close() {
+    queryStatements.clear();
+    for (auto& statement : statements)
+        statement.reset();
     int result = sqlite3_close(db);
     if (result != SQLITE_OK)
         throw DatabaseError(result, sqlite3_errmsg(db));
@@ -60,23 +224,26 @@ void
 Pdfsearch::Database::createDatabase() const {
     assert(db != nullptr);
 
-    const char* sql =
+    const std::string sql = std::string(
         u8"create table Pdfs"
             u8"(id            integer primary key asc,"
             u8" file          text unique not null,"
-            u8" last_modified int not null);"
+            u8" last_modified int not null,"
+            u8" pages         int not null default 0,"
+            u8" text_length   int not null default 0);"
 
         u8"create table PlainTexts"
             u8"(plain_text    text default '',"
             u8" page          int not null,"
             u8" pdfs_id       integer not null references Pdfs(id)"
-            u8"                   on delete cascade);"
+            u8"                   on delete cascade,"
+            u8" folded_text   text not null default '');") +
 
-        u8"create index last_modified_index on Pdfs(last_modified);"
-        u8"create index pdfs_id_index       on PlainTexts(pdfs_id);";
+        CREATE_INDEXES +
+        "PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) + ";";
 
     char* errmsg = nullptr;
-    int result = sqlite3_exec(db, sql, nullptr, nullptr, &errmsg);
+    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errmsg);
     if (result != SQLITE_OK) {
         std::string error(errmsg);
         sqlite3_free(errmsg);
@@ -111,240 +278,1123 @@ Pdfsearch::Database::databaseCreated() const {
     return rows > 0;
 }
 
+/* Another process may migrate at the same time, the version is checked again
+ * after the write lock is taken. */
+void
+Pdfsearch::Database::migrate() const {
+    assert(db != nullptr);
+    if (migrated)
+        return;
+
+    auto version = [this]() {
+        const Statement& s(statement(statement_key::USER_VERSION));
+        const int v = std::get<0>(*s.rows<int>().begin());
+        s.reset();
+        return v;
+    };
+    if (version() >= SCHEMA_VERSION) {
+        migrated = true;
+        return;
+    }
+
+    execute("begin immediate;");
+    try {
+        if (version() < 1) {
+            execute("alter table Pdfs add column pages int not null default 0;"
+                "update Pdfs set pages ="
+                " (select count(*) from PlainTexts where pdfs_id = Pdfs.id);");
+        }
+        if (version() < 2) {
+            /* Text indexes aren't updated with every page, the substring
+             * index is rebuilt from the folded text. */
+            const bool fullText = fullTextIndexCreated();
+            const bool substring = substringIndexCreated();
+            if (fullText)
+                execute(dropTextIndexTriggersSql(FULL_TEXT_INDEX));
+            if (substring) {
+                execute(dropTextIndexTriggersSql(SUBSTRING_INDEX));
+                execute(std::string("drop table ") + SUBSTRING_INDEX + ";");
+            }
+
+            execute("alter table PlainTexts"
+                " add column folded_text text not null default '';"
+                "update PlainTexts set folded_text = fold(plain_text);");
+
+            if (fullText) {
+                execute(createTextIndexSql(FULL_TEXT_INDEX, FULL_TEXT_COLUMN,
+                    FULL_TEXT_TOKENIZER));
+            }
+            if (substring) {
+                execute(createTextIndexSql(SUBSTRING_INDEX, SUBSTRING_COLUMN,
+                    SUBSTRING_TOKENIZER));
+                execute(std::string("insert into ") + SUBSTRING_INDEX + "(" +
+                    SUBSTRING_INDEX + ") values('rebuild');");
+            }
+        }
+        if (version() < 3) {
+            execute("alter table Pdfs"
+                " add column text_length int not null default 0;"
+                "update Pdfs set text_length = (select"
+                " coalesce(sum(length(cast(folded_text as blob))), 0)"
+                " from PlainTexts where pdfs_id = Pdfs.id);");
+        }
+        execute("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) +
+            ";");
+    }
+    catch (const DatabaseError&) {
+        rollback();
+        throw;
+    }
+    commit();
+    migrated = true;
+}
+
+void
+Pdfsearch::Database::createFullTextIndex() const {
+    createTextIndex(FULL_TEXT_INDEX, FULL_TEXT_COLUMN, FULL_TEXT_TOKENIZER);
+}
+
+bool
+Pdfsearch::Database::fullTextIndexCreated() const {
+    return textIndexCreated(FULL_TEXT_INDEX);
+}
+
+void
+Pdfsearch::Database::createSubstringIndex() const {
+    createTextIndex(SUBSTRING_INDEX, SUBSTRING_COLUMN, SUBSTRING_TOKENIZER);
+}
+
+bool
+Pdfsearch::Database::substringIndexCreated() const {
+    return textIndexCreated(SUBSTRING_INDEX);
+}
+
+void
+Pdfsearch::Database::createTextIndex(const std::string& table,
+        const std::string& column, const std::string& tokenizer) const {
+    migrate();
+
+    begin();
+    try {
+        execute(createTextIndexSql(table, column, tokenizer));
+        execute("insert into " + table + "(" + table + ") values('rebuild');");
+    }
+    catch (const DatabaseError&) {
+        rollback();
+        throw;
+    }
+    commit();
+}
+
+/* Checked with every query, another process may create an index while
+ * the connection is open. */
+bool
+Pdfsearch::Database::textIndexCreated(const std::string& table) const {
+    assert(db != nullptr);
+
+    const Statement& s(statement(statement_key::TABLE_EXISTS));
+    s.bind(boost::string_view(table), 1);
+    const auto& rows(s.rows<int>());
+    const bool exists = rows.begin() != rows.end();
+    s.reset();
+
+    return exists;
+}
+
+/* The text indexes are external content FTS5 tables, they store only the
+ * index and read a column of PlainTexts. Triggers keep them in sync with
+ * every insert and delete, also with deletes cascading from Pdfs. */
+static std::string
+createTextIndexSql(const std::string& table, const std::string& column,
+        const std::string& tokenizer) {
+    const std::string insert("insert into " + table + "(rowid, " + column +
+        ") values(new.rowid, new." + column + ");");
+    const std::string remove("insert into " + table + "(" + table +
+        ", rowid, " + column + ") values('delete', old.rowid, old." + column +
+        ");");
+
+    return
+        "create virtual table if not exists " + table +
+            " using fts5(" + column + ", content='PlainTexts',"
+            " tokenize='" + tokenizer + "');"
+
+        "create trigger if not exists " + table + "_insert"
+            " after insert on PlainTexts begin " + insert + " end;"
+        "create trigger if not exists " + table + "_delete"
+            " after delete on PlainTexts begin " + remove + " end;"
+        "create trigger if not exists " + table + "_update"
+            " after update of " + column + " on PlainTexts begin " + remove +
+            insert + " end;";
+}
+
+static std::string
+dropTextIndexTriggersSql(const std::string& table) {
+    return
+        "drop trigger if exists " + table + "_insert;"
+        "drop trigger if exists " + table + "_delete;"
+        "drop trigger if exists " + table + "_update;";
+}
+
 void
 Pdfsearch::Database::vacuum() const {
     execute("vacuum;");
+    for (const std::string table : { FULL_TEXT_INDEX, SUBSTRING_INDEX }) {
+        if (textIndexCreated(table))
+            execute("insert into " + table + "(" + table +
+                ") values('rebuild');");
+    }
 }
 
 static void
-insertPages(const Pdfsearch::Pdf& doc, const Pdfsearch::Statement& s) {
-    auto file(doc.getFile());
-    for (int i = 0; i < doc.numberOfPages(); i++) {
-        auto text(doc.getPage(i));
-
-        s.bind(*text, 1);
-        s.bind(i + 1, 2);
-        s.bind(file, 3);
-        s.step();
-        s.reset();
+printError(const std::exception& e) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    std::cerr << e.what() << std::endl;
+}
+
+/* Pages are extracted straight to the strings which are bound to the
+ * inserts. */
+static std::vector<std::string>
+readPages(const Pdfsearch::Pdf& doc) {
+    std::vector<std::string> pages(doc.numberOfPages());
+    for (size_t i = 0; i < pages.size(); i++)
+        doc.getPage(i, pages[i]);
+
+    return pages;
+}
+
+static std::vector<std::string>
+foldPages(const std::vector<std::string>& pages) {
+    std::vector<std::string> folded;
+    folded.reserve(pages.size());
+    for (const auto& page : pages)
+        folded.push_back(Pdfsearch::CaseFolder::fold(page));
+
+    return folded;
+}
+
+/* Length of texts in bytes. */
+static sqlite3_int64
+textLength(const std::vector<std::string>& texts) {
+    sqlite3_int64 length = 0;
+    for (const auto& text : texts)
+        length += text.size();
+
+    return length;
+}
+
+/* Full batches of pages are inserted with insertManyPages, the rest one by
+ * one. */
+static void
+insertPages(const std::vector<std::string>& pages,
+        const std::vector<std::string>& folded, sqlite3_int64 pdfId,
+        const Pdfsearch::Statement& insertPage,
+        const Pdfsearch::Statement& insertManyPages) {
+    const int size = pages.size();
+    int i = 0;
+
+    insertManyPages.bind(pdfId, 1);
+    for (; i + PAGES_PER_INSERT <= size; i += PAGES_PER_INSERT) {
+        for (int j = 0; j < PAGES_PER_INSERT; j++) {
+            insertManyPages.bind(boost::string_view(pages[i + j]), 3 * j + 2);
+            insertManyPages.bind(boost::string_view(folded[i + j]), 3 * j + 3);
+            insertManyPages.bind(i + j + 1, 3 * j + 4);
+        }
+        insertManyPages.step();
+        insertManyPages.reset();
+    }
+
+    insertPage.bind(pdfId, 4);
+    for (; i < size; i++) {
+        insertPage.bind(boost::string_view(pages[i]), 1);
+        insertPage.bind(boost::string_view(folded[i]), 2);
+        insertPage.bind(i + 1, 3);
+        insertPage.step();
+        insertPage.reset();
+    }
+}
+
+/* fold(text) in SQL, used to migrate old databases. */
+static void
+foldFunction(sqlite3_context* context, int, sqlite3_value** argv) {
+    const unsigned char* text = sqlite3_value_text(argv[0]);
+    if (!text) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    try {
+        const std::string folded(Pdfsearch::CaseFolder::fold(
+            std::string(reinterpret_cast<const char*>(text),
+                sqlite3_value_bytes(argv[0]))));
+        sqlite3_result_text(context, folded.data(), folded.size(),
+            SQLITE_TRANSIENT);
+    }
+    catch (const std::exception& e) {
+        sqlite3_result_error(context, e.what(), -1);
     }
 }
 
 void
-Pdfsearch::Database::update() const {
+Pdfsearch::Database::requestStop() {
+    stopRequested = true;
+}
+
+void
+Pdfsearch::Database::update(const IndexSettings& settings) const {
     namespace fs = boost::filesystem;
     assert(db != nullptr);
 
+    migrate();
+
+    const Statement& getAllPdfs(statement(statement_key::GET_ALL_PDFS1));
+    const Statement& deletePdf(statement(statement_key::DELETE_PDF));
+    const Statement& deletePages(statement(statement_key::DELETE_PAGES));
+    const Statement& insertPage(statement(statement_key::INSERT_PAGE));
+    const Statement& insertManyPages(statement(statement_key::INSERT_PAGES));
+    const Statement& updatePdf(statement(statement_key::UPDATE_PDF));
+
+    int uncommitted = 0;
+    auto lastCommit = std::chrono::steady_clock::now();
     begin();
 
-    stmt_map statements;
-    initStatements(statements);
+    /* A failed commit leaves the transaction open, the next update or index
+     * of the connection couldn't begin one. */
+    try {
+        const auto& pdfs(getAllPdfs.rows<sqlite3_int64, boost::string_view,
+            sqlite3_int64>());
+        sqlite3_int64 id;
+        boost::string_view file;
+        sqlite3_int64 lastModified;
+        for (auto it = pdfs.begin(); it != pdfs.end() && !stopRequested;
+                ++it) {
+            try {
+                std::tie(id, file, lastModified) = *it;
 
-    const auto& getAllPdfs = statements.at(statement_key::GET_ALL_PDFS1).get();
-    const auto& deletePdf = statements.at(statement_key::DELETE_PDF).get();
-    const auto& deletePages = statements.at(statement_key::DELETE_PAGES).get();
-    const auto& insertPage = statements.at(statement_key::INSERT_PAGE).get();
-    const auto& updatePdf = statements.at(statement_key::UPDATE_PDF).get();
-    for (auto it = getAllPdfs->begin(); it != getAllPdfs->end(); it++) {
-        try {
-            const auto& id(it.column<int>(0));
-            const auto& file(it.column<std::string>(1));
-            const auto& lastModified(it.column<sqlite3_int64>(2));
-
-            const fs::path p(*file);
-            if (fs::exists(p)) {
-                const auto& newLastModified = fs::last_write_time(p);
-                if (newLastModified > *lastModified) {
-                    updatePdf->bind<sqlite3_int64>(newLastModified, 1);
-                    updatePdf->bind(*id, 2);
-                    updatePdf->step();
-                    updatePdf->reset();
-
-                    deletePages->bind(*id, 1);
-                    deletePages->step();
-                    deletePages->reset();
-
-                    Pdf doc(*file);
-                    insertPages(doc, *insertPage);
+                const fs::path p(file.begin(), file.end());
+                if (fs::exists(p)) {
+                    const auto& newLastModified = fs::last_write_time(p);
+                    if (newLastModified > lastModified) {
+                        /* A pdf which can't be read is left as it was. */
+                        Pdf doc(p.string(), settings.mmap);
+                        const auto& pages(readPages(doc));
+
+                        const auto& folded(foldPages(pages));
+
+                        updatePdf.bind<sqlite3_int64>(newLastModified, 1);
+                        updatePdf.bind(id, 2);
+                        updatePdf.bind<int>(pages.size(), 3);
+                        updatePdf.bind(textLength(folded), 4);
+                        updatePdf.step();
+                        updatePdf.reset();
+
+                        deletePages.bind(id, 1);
+                        deletePages.step();
+                        deletePages.reset();
+
+                        insertPages(pages, folded, id, insertPage,
+                            insertManyPages);
+                        uncommitted++;
+                    }
+                }
+                else {
+                    deletePdf.bind(id, 1);
+                    deletePdf.step();
+                    deletePdf.reset();
+                    uncommitted++;
                 }
             }
-            else {
-                deletePdf->bind(*id, 1);
-                deletePdf->step();
-                deletePdf->reset();
+            catch (const std::exception& e) {
+                printError(e);
             }
+            checkpoint(settings, uncommitted, lastCommit);
+        }
+        getAllPdfs.reset();
+
+        commit();
+    }
+    catch (...) {
+        stopRequested = false;
+        /* The error of the update is more useful than the ones of the reset
+         * and the rollback. A failed step is reported again by reset(). */
+        try {
+            getAllPdfs.reset();
+        }
+        catch (const DatabaseError&) {
+        }
+        try {
+            rollback();
         }
-        catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+        catch (const DatabaseError&) {
         }
+        throw;
     }
-
-    commit();
+    stopRequested = false;
 }
 
 std::vector<Pdfsearch::QueryResult>
 Pdfsearch::Database::query(const std::string& query, bool verbose, int matches)
         const {
+    QuerySettings settings;
+    settings.verbose = verbose;
+    settings.matches = matches;
+
+    return this->query(query, settings);
+}
+
+std::vector<Pdfsearch::QueryResult>
+Pdfsearch::Database::query(const std::string& query,
+        const QuerySettings& settings) const {
+    std::vector<QueryResult> results;
+    this->query(query, settings, [&](const QueryResult& result) {
+        results.push_back(result);
+    });
+
+    return results;
+}
+
+void
+Pdfsearch::Database::query(const std::string& query,
+        const QuerySettings& settings, const result_callback& found) const {
     assert(db != nullptr);
 
-    std::string q("%" + query + "%");
+    const bool files = settings.filesWithMatches;
+    const bool relevance = settings.sort == "relevance";
+    const std::string order(relevance ? "" : orderBy(settings.sort, files));
+    if (settings.fullText && settings.regex) {
+        throw std::invalid_argument(
+            "full-text and regex queries are mutually exclusive");
+    }
+    if (settings.fuzzy != 0 && !settings.fullText)
+        throw std::invalid_argument("fuzzy query needs full-text query");
+
+    struct ResetStatements {
+        const Database& db;
+        ~ResetStatements() { db.resetQueryStatements(); }
+    } resetStatements{ *this };
+
+    migrate();
+
+    if (settings.fullText) {
+        queryFullText(query, settings, found);
+        return;
+    }
+    else if (settings.regex) {
+        queryRegex(query, settings, found);
+        return;
+    }
 
-    stmt_map statements;
-    initStatements(statements);
-    const auto& getAllPdfs = statements.at(statement_key::GET_ALL_PDFS2);
+    /* Pages are searched from their folded text. */
+    const std::string folded(CaseFolder::fold(query));
+    std::string q("%" + folded + "%");
+
+    /* The trigram index finds pages having every trigram of the pattern,
+     * LIKE on the candidates keeps the results the same as with a scan.
+     * Relevance is scored from every matching page, also with
+     * filesWithMatches. */
+    const bool trigrams = longestLiteral(q) >= MIN_TRIGRAM_LITERAL &&
+        substringIndexCreated();
+    const std::string pages(trigrams ? std::string(SUBSTRING_INDEX) +
+        " G cross join PlainTexts T on T.rowid = G.rowid" : "PlainTexts T");
+    const std::string like(trigrams ?
+        " where G.folded_text like ?1 and T.folded_text like ?1" :
+        " where T.folded_text like ?1");
+    const std::string pageOrder(relevance ? rowOrder(trigrams) : order);
+    std::string sql;
+    if (files && !relevance && trigrams) {
+        sql = "select P.file, null, null, null, null from Pdfs P where P.id"
+            " in (select T.pdfs_id from " + pages + like + ")";
+    }
+    else if (files && !relevance) {
+        /* Pages of a pdf are read until the first match. */
+        sql = "select P.file, null, null, null, null from Pdfs P where"
+            " exists (select 1 from " + pages + like + " and T.pdfs_id = P.id)";
+    }
+    else {
+        /* Sorted rows are kept until they are sorted, texts are read only
+         * when they are needed. */
+        sql = std::string("select P.file, ") +
+            (settings.verbose ? "T.plain_text" : "null") +
+            ", T.page, P.pages, " +
+            (settings.verbose || relevance ? "T.folded_text" : "null") +
+            " from " + pages + " cross join Pdfs P on P.id = T.pdfs_id" +
+            like;
+    }
+    const Statement* getAllPdfs = &queryStatement(sql + pageOrder +
+        " limit ?2;");
     getAllPdfs->bind(q, 1);
+    getAllPdfs->bind(relevance ? -1 : sqlLimit(settings.matches), 2);
 
-    std::vector<QueryResult> results;
+    /* The snippet is cut from the text if it has the query with ASCII
+     * case folding, otherwise from the folded text. */
+    const Snippet snippet(query, settings.wordsBefore, settings.wordsAfter);
+    const Snippet foldedSnippet(folded, settings.wordsBefore,
+        settings.wordsAfter);
+    if (relevance) {
+        /* A page LIKE matches has a match even if the wildcards of LIKE
+         * aren't counted. */
+        queryByRelevance(settings, *getAllPdfs,
+            [&](boost::string_view foldedText) {
+                return std::max(1, foldedSnippet.count(foldedText));
+            },
+            [&](boost::string_view text, boost::string_view foldedText) {
+                std::string chunk(snippet.find(text));
+                if (chunk.empty())
+                    chunk = foldedSnippet.find(foldedText);
+                return chunk.empty() ? query : chunk;
+            }, found);
+        return;
+    }
+    QueryResult qr;
+    for (const auto& row : pageRows(*getAllPdfs)) {
+        assign(qr.file, std::get<0>(row));
 
-    boost::regex pattern("((?:\\s+\\S+){0,5}\\s*" + query + "\\s*(?:\\S+\\s+){0,5})",
-        boost::regex::icase);
-    for (auto it = getAllPdfs->begin();
-        it != getAllPdfs->end() && (matches == Options::UNLIMITED_MATCHES ||
-                          it.getRow() <= matches);
-            it++) {
-        QueryResult qr;
-        qr.file = *(it.column<std::string>(0));
+        if (settings.verbose && !files) {
+            qr.page = *std::get<2>(row);
+            qr.pages = *std::get<3>(row);
 
-        if (verbose) {
-            qr.page = *(it.column<int>(2));
-            qr.pages = *(it.column<int>(3));
-
-            boost::smatch m;
-            const auto& text(it.column<std::string>(1));
-            if (boost::regex_search(text->cbegin(), text->cend(), m, pattern))
-                qr.chunk = std::string(m[1].first, m[1].second);
-            else
+            qr.chunk = snippet.find(*std::get<1>(row));
+            if (qr.chunk.empty())
+                qr.chunk = foldedSnippet.find(*std::get<4>(row));
+            if (qr.chunk.empty())
                 qr.chunk = query;
         }
-        results.push_back(qr);
+        found(qr);
     }
-
-    return results;
 }
 
+/* Pages are scored with BM25 as they are read and only the best results are
+ * kept. A pdf is scored by its best page, the pages are read in the order of
+ * rowOrder(), so the best page of a pdf is known when the next pdf starts. */
 void
-Pdfsearch::Database::initStatements(Pdfsearch::Database::stmt_map& m) const {
-    m.insert(std::make_pair(statement_key::IS_PDF_IN_DB,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "select id, last_modified from Pdfs where file = ?1;"))));
-    m.insert(std::make_pair(statement_key::INSERT_PDF,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "insert into Pdfs(file, last_modified) values(?1, ?2);"))));
-    m.insert(std::make_pair(statement_key::INSERT_PAGE,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "insert into PlainTexts(plain_text, page, pdfs_id)"
-           "values(?1, ?2, (select id from Pdfs where file = ?3));"))));
-    m.insert(std::make_pair(statement_key::DELETE_PAGES,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "delete from PlainTexts where pdfs_id = ?1;"))));
-    m.insert(std::make_pair(statement_key::DELETE_PDF,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "delete from Pdfs where id = ?1;"))));
-    m.insert(std::make_pair(statement_key::UPDATE_PDF,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "update Pdfs set last_modified = ?1 where id = ?2;"))));
-    m.insert(std::make_pair(statement_key::GET_ALL_PDFS1,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "select id, file, last_modified from Pdfs;"))));
-    m.insert(std::make_pair(statement_key::GET_ALL_PDFS2,
-       std::unique_ptr<Statement>(new Statement(*this,
-       "select (select file from Pdfs where id = pdfs_id),"
-           " plain_text, page,"
-           " (select count(*) from PlainTexts P1"
-               " where P1.pdfs_id = P2.pdfs_id) from PlainTexts P2"
-               " where plain_text like ?1;"))));
+Pdfsearch::Database::queryByRelevance(const QuerySettings& settings,
+        const Statement& pages,
+        const std::function<int(boost::string_view)>& frequency,
+        const std::function<std::string(boost::string_view,
+            boost::string_view)>& chunk,
+        const result_callback& found) const {
+    const Statement& average(queryStatement(
+        "select total(text_length) / max(total(pages), 1) from Pdfs;"));
+    const double averageLength = std::get<0>(*average.rows<double>().begin());
+
+    const bool files = settings.filesWithMatches;
+    TopK<RankedResult, decltype(&lessRelevant)> top(settings.matches,
+        lessRelevant);
+    RankedResult best;
+    bool hasBest = false;
+    size_t order = 0;
+    for (const auto& row : pageRows(pages)) {
+        const boost::string_view folded(*std::get<4>(row));
+        const int matches = frequency(folded);
+        if (matches == 0)
+            continue;
+
+        RankedResult r;
+        r.score = bm25(matches, folded.size(), averageLength);
+        r.order = order++;
+
+        if (files) {
+            const boost::string_view file(std::get<0>(row));
+            if (hasBest && file == best.result.file) {
+                if (lessRelevant(best, r)) {
+                    best.score = r.score;
+                    best.order = r.order;
+                }
+                continue;
+            }
+            if (hasBest)
+                top.push(std::move(best));
+            best = std::move(r);
+            best.result.file = file.to_string();
+            hasBest = true;
+            continue;
+        }
+        /* Snippets are cut only for the results which are kept. */
+        if (!top.admits(r))
+            continue;
+
+        r.result.file = std::get<0>(row).to_string();
+        if (settings.verbose) {
+            r.result.page = *std::get<2>(row);
+            r.result.pages = *std::get<3>(row);
+
+            r.result.chunk = chunk(*std::get<1>(row), folded);
+        }
+        top.push(std::move(r));
+    }
+    if (hasBest)
+        top.push(std::move(best));
+
+    for (const auto& r : top.take())
+        found(r.result);
 }
 
-void
-Pdfsearch::Database::index(const std::vector<std::string>& directories,
-        const int MAX_DEPTH) const {
-    assert(db != nullptr);
+/* The sorted terms of the full-text index are read with fts5vocab. A term
+ * having a prefix which can't be extended to a match is followed by the
+ * terms with the same prefix, those are skipped with a new search. */
+std::vector<std::string>
+Pdfsearch::Database::fuzzyTerms(const std::string& word, int distance) const {
+    /* Terms of the unicode61 tokenizer are case folded and have only
+     * letters and digits, other words can't be near them. */
+    const std::string folded(CaseFolder::fold(word));
+    const int32_t length = folded.size();
+    for (int32_t i = 0; i < length; ) {
+        UChar32 c;
+        U8_NEXT(folded.data(), i, length, c);
+        if (!u_isalnum(c))
+            return std::vector<std::string>();
+    }
 
-    begin();
+    execute(std::string("create virtual table if not exists temp.") +
+        FULL_TEXT_TERMS + " using fts5vocab(main, " + FULL_TEXT_INDEX +
+        ", row);");
+    const Statement& terms(queryStatement(
+        std::string("select term from temp.") + FULL_TEXT_TERMS +
+        " where term >= ?1;"));
 
-    stmt_map statements;
-    initStatements(statements);
+    const LevenshteinAutomaton automaton(folded, distance);
+    std::vector<std::string> found;
+    std::string from;
+    std::string term;
+    for (bool more = true; more; ) {
+        more = false;
+        terms.reset();
+        terms.bind(from, 1);
+        for (const auto& row : terms.rows<boost::string_view>()) {
+            assign(term, std::get<0>(row));
+            size_t deadPrefix;
+            if (automaton.match(term, deadPrefix))
+                found.push_back(term);
+            else if (deadPrefix != std::string::npos) {
+                more = LevenshteinAutomaton::successor(
+                    term.substr(0, deadPrefix), from);
+                break;
+            }
+        }
+    }
 
-    for (const auto& d : directories) {
-        try {
-            int depth = 0;
-            iterateDirectory(d, depth, MAX_DEPTH, statements);
+    return found;
+}
+
+/* The expression is matched on the folded text, pages and pdfs are read
+ * until enough of them match. */
+void
+Pdfsearch::Database::queryRegex(const std::string& query,
+        const QuerySettings& settings, const result_callback& found) const {
+    const Regexp regexp(query);
+
+    const bool files = settings.filesWithMatches;
+    const bool verbose = settings.verbose && !files;
+    const bool relevance = settings.sort == "relevance";
+    const bool trigrams = !regexp.getTrigramQuery().empty() &&
+        substringIndexCreated();
+    const std::string pages(trigrams ? std::string(SUBSTRING_INDEX) +
+        " G cross join PlainTexts T on T.rowid = G.rowid" : "PlainTexts T");
+    const Statement& s(queryStatement(std::string("select P.file, ") +
+        (verbose ? "T.plain_text" : "null") +
+        ", T.page, P.pages, T.folded_text from " + pages +
+        " cross join Pdfs P on P.id = T.pdfs_id" +
+        (trigrams ? std::string(" where G.folded_text match ?1") : "") +
+        (relevance ? rowOrder(trigrams) : orderBy(settings.sort, false)) +
+        ";"));
+    if (trigrams)
+        s.bind(regexp.getTrigramQuery(), 1);
+
+    /* The snippet is cut from the text if the expression matches it,
+     * otherwise from the folded text. */
+    auto chunk = [&](boost::string_view text, boost::string_view folded)
+            -> std::string {
+        size_t begin, end;
+        if (regexp.match(text, 0, begin, end)) {
+            return Snippet::cut(text, begin, end, settings.wordsBefore,
+                settings.wordsAfter);
         }
-        catch (const boost::filesystem::filesystem_error& e) {
-            std::cerr << e.what() << std::endl;
+        else if (regexp.match(folded, 0, begin, end)) {
+            return Snippet::cut(folded, begin, end, settings.wordsBefore,
+                settings.wordsAfter);
         }
+        return query;
+    };
+    if (relevance) {
+        queryByRelevance(settings, s,
+            [&](boost::string_view folded) { return regexp.count(folded); },
+            chunk, found);
+        return;
     }
 
-    commit();
+    std::set<std::string> foundFiles;
+    int results = 0;
+    QueryResult qr;
+    const auto& rows(pageRows(s));
+    for (auto it = rows.begin(); it != rows.end() &&
+            (settings.matches == Options::UNLIMITED_MATCHES ||
+             results < settings.matches); ++it) {
+        const auto& row(*it);
+        assign(qr.file, std::get<0>(row));
+        if (files && foundFiles.count(qr.file) > 0)
+            continue;
+
+        const boost::string_view folded(*std::get<4>(row));
+        size_t begin, end;
+        if (!regexp.match(folded, 0, begin, end))
+            continue;
+
+        if (files)
+            foundFiles.insert(qr.file);
+        else if (verbose) {
+            qr.page = *std::get<2>(row);
+            qr.pages = *std::get<3>(row);
+            qr.chunk = chunk(*std::get<1>(row), folded);
+        }
+        results++;
+        found(qr);
+    }
 }
 
 void
-Pdfsearch::Database::insertPdf(const boost::filesystem::path& p,
-    const Pdfsearch::Database::stmt_map& statements
-        ) const {
-    auto file(boost::filesystem::canonical(p).native());
-    Pdf doc(file);
+Pdfsearch::Database::queryFullText(const std::string& query,
+        const QuerySettings& settings, const result_callback& found) const {
+    if (!fullTextIndexCreated())
+        throw DatabaseError("full-text index doesn't exist");
 
-    const auto& isPdfInDB = statements.at(statement_key::IS_PDF_IN_DB).get();
-    isPdfInDB->bind(file, 1);
-    std::unique_ptr<sqlite3_int64> lastModified;
-    std::unique_ptr<int> id;
-    for (auto it = isPdfInDB->begin(); it != isPdfInDB->end(); it++) {
-        id = std::move(it.column<int>(0));
-        lastModified = std::move(it.column<sqlite3_int64>(1));
+    QueryParser::expand_function expand;
+    if (settings.fuzzy > 0) {
+        expand = [&](const std::string& word) {
+            return fuzzyTerms(word, settings.fuzzy);
+        };
     }
-    isPdfInDB->reset();
+    const std::string match(QueryParser::toMatch(query, expand));
+    if (match.empty())
+        return;
 
-    const auto& newLastModified(boost::filesystem::last_write_time(p));
-    const auto& insertPage = statements.at(statement_key::INSERT_PAGE).get();
-    if (lastModified == nullptr) {
-        const auto& insertPdf = statements.at(statement_key::INSERT_PDF).get();
-        insertPdf->bind(file, 1);
-        insertPdf->bind<sqlite3_int64>(newLastModified, 2);
-        insertPdf->step();
-        insertPdf->reset();
+    /* Snippets and page counts are only needed for verbose results. FTS5
+     * ranks pages with BM25 and a pdf is ranked by its best page. */
+    const bool files = settings.filesWithMatches;
+    const bool verbose = settings.verbose && !files;
+    const bool relevance = settings.sort == "relevance";
+    const std::string pages(" from PageIndex"
+        " join PlainTexts T on T.rowid = PageIndex.rowid");
+    std::string sql;
+    if (files && !relevance) {
+        sql = "select P.file, null, null, null, null from Pdfs P where P.id in"
+            " (select T.pdfs_id" + pages + " where PageIndex match ?1)" +
+            orderBy(settings.sort, files);
+    }
+    else {
+        sql = std::string("select P.file, ") + (verbose ?
+            "snippet(PageIndex, 0, '', '', '...', ?2), T.page, P.pages" :
+            "null, null, null") + ", null" + pages +
+            " join Pdfs P on P.id = T.pdfs_id where PageIndex match ?1" +
+            (!relevance ? orderBy(settings.sort, files) :
+             files ? " group by P.id order by min(rank)" : " order by rank");
+    }
+    const Statement& s(queryStatement(sql + " limit ?3;"));
+    s.bind(match, 1);
+    if (verbose)
+        s.bind(std::min(MAX_SNIPPET_WORDS,
+            settings.wordsBefore + settings.wordsAfter + 1), 2);
+    s.bind(sqlLimit(settings.matches), 3);
 
-        insertPages(doc, *insertPage);
+    QueryResult qr;
+    for (const auto& row : pageRows(s)) {
+        assign(qr.file, std::get<0>(row));
+
+        if (verbose) {
+            assign(qr.chunk, *std::get<1>(row));
+            qr.page = *std::get<2>(row);
+            qr.pages = *std::get<3>(row);
+        }
+        found(qr);
     }
-    else if (*lastModified < newLastModified) {
-        const auto& deletePages = statements.at(statement_key::DELETE_PAGES).get();
-        deletePages->bind(*id, 1);
-        deletePages->step();
-        deletePages->reset();
+}
 
-        const auto& updatePdf = statements.at(statement_key::UPDATE_PDF).get();
-        updatePdf->bind<sqlite3_int64>(newLastModified, 1);
-        updatePdf->bind(*id, 2);
-        updatePdf->step();
-        updatePdf->reset();
+/* A string reused for every row keeps its buffer, copying a column to it
+ * doesn't allocate unless the value is longer than before. */
+static void
+assign(std::string& s, boost::string_view value) {
+    s.assign(value.data(), value.size());
+}
 
-        insertPages(doc, *insertPage);
+static page_rows
+pageRows(const Pdfsearch::Statement& s) {
+    return s.rows<boost::string_view, boost::optional<boost::string_view>,
+        boost::optional<int>, boost::optional<int>,
+        boost::optional<boost::string_view>>();
+}
+
+/* A negative LIMIT has no upper bound. */
+static int
+sqlLimit(int matches) {
+    return matches == Pdfsearch::Options::UNLIMITED_MATCHES ? -1 : matches;
+}
+
+/* ORDER BY clause of a query sorted by path or mtime. Pdfs P and, unless
+ * files, PlainTexts T are in the query. */
+static std::string
+orderBy(const std::string& sort, bool files) {
+    if (sort.empty())
+        return "";
+    else if (sort == "path")
+        return files ? " order by P.file" : " order by P.file, T.page";
+    else if (sort == "mtime") {
+        return files ? " order by P.last_modified desc, P.file" :
+            " order by P.last_modified desc, P.file, T.page";
     }
+    else if (sort == "relevance")
+        return "";
+
+    throw std::invalid_argument("unknown sort '" + sort + "'");
 }
 
-void
-Pdfsearch::Database::iterateDirectory(const boost::filesystem::path& p,
-    int depth, const int MAX_DEPTH,
-    const Pdfsearch::Database::stmt_map& statements
-        ) const {
-    namespace fs = boost::filesystem;
+/* Pages in the order they were inserted, which has the pages of a pdf in a
+ * row. The order of the index table is the order of its scan, an order of
+ * PlainTexts would be sorted. */
+static std::string
+rowOrder(bool trigrams) {
+    return trigrams ? " order by G.rowid" : " order by T.rowid";
+}
 
-    auto end = fs::directory_iterator();
-    for (auto it = fs::directory_iterator(p); it != end; ++it) {
+/* BM25 of a page for a query of one term. The inverse document frequency of
+ * the term is the same for every page and doesn't change the order, so it's
+ * left out. */
+static double
+bm25(int frequency, size_t length, double averageLength) {
+    const double relativeLength = averageLength > 0 ?
+        length / averageLength : 1;
+
+    return frequency * (BM25_K1 + 1) /
+        (frequency + BM25_K1 * (1 - BM25_B + BM25_B * relativeLength));
+}
+
+static bool
+lessRelevant(const RankedResult& a, const RankedResult& b) {
+    return a.score < b.score || (a.score == b.score && a.order > b.order);
+}
+
+/* Length of the longest run of characters without wildcards, in UTF-8
+ * characters. */
+static int
+longestLiteral(const std::string& pattern) {
+    int longest = 0;
+    int length = 0;
+    for (char c : pattern) {
+        if (c == '%' || c == '_')
+            length = 0;
+        /* Continuation bytes don't start a character. */
+        else if ((c & 0xC0) != 0x80)
+            longest = std::max(longest, ++length);
+    }
+
+    return longest;
+}
+
+/* SQL of the statements by key. */
+static std::string
+statementSql(Pdfsearch::Database::statement_key key) {
+    typedef Pdfsearch::Database::statement_key statement_key;
+    switch (key) {
+        case statement_key::IS_PDF_IN_DB:
+            return "select id, last_modified from Pdfs where file = ?1;";
+        case statement_key::INSERT_PDF:
+            return "insert into Pdfs(file, last_modified, pages, text_length)"
+                " values(?1, ?2, ?3, ?4);";
+        case statement_key::INSERT_PAGE:
+            return "insert into PlainTexts"
+                "(plain_text, folded_text, page, pdfs_id)"
+                " values(?1, ?2, ?3, ?4);";
+        case statement_key::INSERT_PAGES: {
+            /* ?1 is pdfs_id, the rows are (?2, ?3, ?4), (?5, ?6, ?7), ... */
+            std::string sql("insert into PlainTexts"
+                "(plain_text, folded_text, page, pdfs_id) values");
+            for (int i = 0; i < PAGES_PER_INSERT; i++) {
+                sql += (i == 0 ? "(?" : ",(?") + std::to_string(3 * i + 2) +
+                    ", ?" + std::to_string(3 * i + 3) +
+                    ", ?" + std::to_string(3 * i + 4) + ", ?1)";
+            }
+
+            return sql + ";";
+        }
+        case statement_key::DELETE_PAGES:
+            return "delete from PlainTexts where pdfs_id = ?1;";
+        case statement_key::UPDATE_PDF:
+            return "update Pdfs set last_modified = ?1, pages = ?3,"
+                " text_length = ?4 where id = ?2;";
+        case statement_key::GET_ALL_PDFS1:
+            return "select id, file, last_modified from Pdfs;";
+        case statement_key::DELETE_PDF:
+            return "delete from Pdfs where id = ?1;";
+        case statement_key::USER_VERSION:
+            return "PRAGMA user_version;";
+        case statement_key::TABLE_EXISTS:
+            return "select 1 from sqlite_master"
+                " where type = 'table' and name = ?1;";
+    }
+    assert(false);
+
+    return "";
+}
+
+const Pdfsearch::Statement&
+Pdfsearch::Database::statement(statement_key key) const {
+    std::unique_ptr<Statement>& s(statements[static_cast<size_t>(key)]);
+    if (!s) {
+        s.reset(new Statement(*this, statementSql(key),
+            SQLITE_PREPARE_PERSISTENT));
+    }
+
+    return *s;
+}
+
+const Pdfsearch::Statement&
+Pdfsearch::Database::queryStatement(const std::string& sql) const {
+    auto it = queryStatements.find(sql);
+    if (it == queryStatements.end()) {
+        it = queryStatements.insert(std::make_pair(sql,
+            std::unique_ptr<Statement>(new Statement(*this, sql,
+                SQLITE_PREPARE_PERSISTENT)))).first;
+    }
+
+    return *(it->second);
+}
+
+void
+Pdfsearch::Database::resetQueryStatements() const {
+    for (const auto& statement : queryStatements) {
+        /* The error of a failed step was thrown by the query. */
         try {
-            if (fs::is_directory(it->path()) && !fs::is_symlink(it->path()) &&
-                    (MAX_DEPTH == Options::RECURSE_INFINITELY || depth < MAX_DEPTH)) {
-                iterateDirectory(it->path(), ++depth, MAX_DEPTH, statements);
+            statement.second->reset();
+        }
+        catch (const DatabaseError& e) {
+        }
+    }
+}
+
+Pdfsearch::IndexStats
+Pdfsearch::Database::index(const std::vector<std::string>& directories,
+        const int MAX_DEPTH, const IndexSettings& settings) const {
+    assert(db != nullptr);
+    assert(settings.jobs > 0);
+
+    const int jobs = settings.jobs;
+    const auto start = std::chrono::steady_clock::now();
+    IndexStats stats{ 0, 0, 0.0, false };
+    auto walker(Walker::create(settings.walker, settings.walkJobs));
+
+    migrate();
+    begin();
+
+    /* Pdfs already in the database, the walker skips unchanged pdfs before
+     * they are parsed. */
+    mtime_map indexed;
+    BoundedQueue<PdfFile> files(FILES_PER_JOB * jobs);
+    BoundedQueue<PdfText> texts(TEXTS_PER_JOB * jobs);
+    std::atomic<int> runningJobs(jobs);
+
+    auto found = [&](const std::string& file, std::time_t lastModified) {
+        const auto& i = indexed.find(file);
+        if (i == indexed.end() || i->second < lastModified)
+            files.push(PdfFile{ file, lastModified });
+    };
+    auto walk = [&]() {
+        for (const auto& d : directories) {
+            try {
+                walker->walk(d, MAX_DEPTH, found, printError);
+            }
+            catch (const std::exception& e) {
+                printError(e);
+            }
+        }
+        files.close();
+    };
+
+    /* Every job has its own poppler document, or its own worker process. */
+    auto extract = [&]() {
+        std::unique_ptr<WorkerProcess> worker;
+        PdfFile f;
+        while (files.pop(f)) {
+            try {
+                PdfText t{ f.file, f.lastModified, {}, {} };
+                if (settings.processes) {
+                    if (!worker)
+                        worker.reset(new WorkerProcess(settings.timeout,
+                            settings.mmap));
+                    t.pages = worker->extract(f.file);
+                }
+                else {
+                    Pdf doc(f.file, settings.mmap);
+                    t.pages = readPages(doc);
+                }
+                /* Folded here to keep the writer free. */
+                t.folded = foldPages(t.pages);
+                if (!texts.push(std::move(t)))
+                    break;
+            }
+            catch (const std::exception& e) {
+                printError(e);
+            }
+
+            /* Recycle a crashed or a bloated worker. */
+            if (worker && (!worker->isRunning() ||
+                    (settings.maxDocuments > 0 &&
+                     worker->getDocuments() >= settings.maxDocuments) ||
+                    (settings.maxMemory > 0 && worker->getMemoryGrowth() >=
+                     settings.maxMemory * 1024L * 1024L))) {
+                worker.reset();
             }
-            else if (fs::is_regular_file(it->path()) &&
-                    !fs::is_symlink(it->path()) &&
-                    Pdf::filenameEndsToPdf(it->path().native())) {
-                insertPdf(it->path(), statements);
+        }
+        worker.reset();
+        if (--runningJobs == 0)
+            texts.close();
+    };
+
+    /* A joinable thread terminates the process when destroyed, so on an
+     * error the threads are stopped and joined before the transaction is
+     * rolled back. */
+    std::vector<std::thread> threads;
+    try {
+        const Statement& getAllPdfs(statement(statement_key::GET_ALL_PDFS1));
+        for (const auto& row : getAllPdfs.rows<sqlite3_int64,
+                boost::string_view, sqlite3_int64>()) {
+            indexed[std::get<1>(row).to_string()] = std::get<2>(row);
+        }
+        getAllPdfs.reset();
+
+        /* Indexes are cheaper to build once than to update on every
+         * insert. */
+        const bool bulk = settings.bulk && indexed.empty();
+        if (bulk)
+            execute("drop index if exists last_modified_index;"
+                "drop index if exists pdfs_id_index;");
+
+        threads.emplace_back(walk);
+        for (int i = 0; i < jobs; i++)
+            threads.emplace_back(extract);
+
+        /* This thread is the only writer to the database. */
+        int uncommitted = 0;
+        auto lastCommit = std::chrono::steady_clock::now();
+        PdfText text;
+        while (!texts.isDrained()) {
+            if (stopRequested && !stats.stopped) {
+                /* Pdfs being extracted are still written. */
+                stats.stopped = true;
+                walker->stop();
+                files.abort();
             }
+
+            if (texts.pop(text, STOP_POLL_INTERVAL)) {
+                try {
+                    if (insertPdf(text)) {
+                        stats.pdfs++;
+                        stats.pages += text.pages.size();
+                        uncommitted++;
+                    }
+                }
+                catch (const std::exception& e) {
+                    printError(e);
+                }
+            }
+            checkpoint(settings, uncommitted, lastCommit);
         }
-        catch (const std::exception& e) {
-            std::cerr << e.what() << std::endl;
+
+        for (auto& thread : threads)
+            thread.join();
+
+        /* Also recreates indexes dropped by an interrupted bulk index. */
+        execute(CREATE_INDEXES);
+        commit();
+    }
+    catch (...) {
+        walker->stop();
+        files.abort();
+        texts.abort();
+        for (auto& thread : threads) {
+            if (thread.joinable())
+                thread.join();
         }
+        stopRequested = false;
+        /* The error of the index is more useful than the one of the
+         * rollback. */
+        try {
+            rollback();
+        }
+        catch (const DatabaseError&) {
+        }
+        throw;
+    }
+    stopRequested = false;
+
+    stats.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    return stats;
+}
+
+bool
+Pdfsearch::Database::insertPdf(const Pdfsearch::Database::PdfText& pdf)
+        const {
+    const Statement& isPdfInDB(statement(statement_key::IS_PDF_IN_DB));
+    isPdfInDB.bind(boost::string_view(pdf.file), 1);
+    boost::optional<sqlite3_int64> lastModified;
+    sqlite3_int64 id = 0;
+    for (const auto& row : isPdfInDB.rows<sqlite3_int64, sqlite3_int64>()) {
+        id = std::get<0>(row);
+        lastModified = std::get<1>(row);
+    }
+    isPdfInDB.reset();
+
+    const Statement& insertPage(statement(statement_key::INSERT_PAGE));
+    const Statement& insertManyPages(statement(statement_key::INSERT_PAGES));
+    if (!lastModified) {
+        const Statement& insertPdf(statement(statement_key::INSERT_PDF));
+        insertPdf.bind(boost::string_view(pdf.file), 1);
+        insertPdf.bind<sqlite3_int64>(pdf.lastModified, 2);
+        insertPdf.bind<int>(pdf.pages.size(), 3);
+        insertPdf.bind(textLength(pdf.folded), 4);
+        insertPdf.step();
+        insertPdf.reset();
+
+        insertPages(pdf.pages, pdf.folded, sqlite3_last_insert_rowid(db),
+            insertPage, insertManyPages);
+    }
+    else if (*lastModified < pdf.lastModified) {
+        const Statement& deletePages(statement(statement_key::DELETE_PAGES));
+        deletePages.bind(id, 1);
+        deletePages.step();
+        deletePages.reset();
+
+        const Statement& updatePdf(statement(statement_key::UPDATE_PDF));
+        updatePdf.bind<sqlite3_int64>(pdf.lastModified, 1);
+        updatePdf.bind(id, 2);
+        updatePdf.bind<int>(pdf.pages.size(), 3);
+        updatePdf.bind(textLength(pdf.folded), 4);
+        updatePdf.step();
+        updatePdf.reset();
+
+        insertPages(pdf.pages, pdf.folded, id, insertPage, insertManyPages);
+    }
+    else
+        return false;
+
+    return true;
+}
+
+/* Committed pdfs survive a crash or a reboot, and aren't parsed again by the
+ * next index, because the walker skips unchanged pdfs. */
+void
+Pdfsearch::Database::checkpoint(const IndexSettings& settings,
+        int& uncommitted,
+        std::chrono::steady_clock::time_point& lastCommit) const {
+    if (uncommitted == 0)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if ((settings.commitEvery > 0 && uncommitted >= settings.commitEvery) ||
+            (settings.commitSeconds > 0 &&
+             now - lastCommit >= std::chrono::seconds(settings.commitSeconds))) {
+        commit();
+        begin();
+        uncommitted = 0;
+        lastCommit = now;
     }
 }
 
@@ -2,13 +2,18 @@
     #define DATABASE_H
 
 #include <sqlite3.h>
+#include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <functional>
 #include <boost/filesystem.hpp>
+#include <boost/utility/string_view.hpp>
 #include "statement.h"
 #include "pdf.h"
+#include "boundedqueue.h"
 
 namespace Pdfsearch {
     class Statement;
@@ -24,6 +29,126 @@ namespace Pdfsearch {
         int pages;
     };
 
+    /** Settings for Database#query(const std::string&,
+     * const QuerySettings&) const. */
+    struct QuerySettings {
+        /** If false, only QueryResult::file member is set in the results,
+         * otherwise all members are set. */
+        bool verbose;
+        /** Maximum number of results, Options::UNLIMITED_MATCHES for all. */
+        int matches;
+        /** Find pages matching a boolean query of words and phrases with
+         * the full-text index, instead of pages containing the query with
+         * LIKE. */
+        bool fullText;
+        /** With fullText, also find the terms within this edit distance
+         * of every word of the query, 0 for only the words. */
+        int fuzzy;
+        /** Find pages matching a regular expression, see Regexp. The
+         * substring index finds the candidate pages if it exists, otherwise
+         * every page is searched. Can't be used with fullText. */
+        bool regex;
+        /** Return every matching pdf once, with only QueryResult::file set.
+         * The pages of a pdf after its first match aren't read. */
+        bool filesWithMatches;
+        /** Number of words before a match in QueryResult::chunk. */
+        int wordsBefore;
+        /** Number of words after a match in QueryResult::chunk. Full-text
+         * queries have a snippet of wordsBefore + wordsAfter + 1 words, at
+         * most 64. */
+        int wordsAfter;
+        /** Order of the results: "relevance", best BM25 score first,
+         * "path", by file and page, or "mtime", the most recently modified
+         * pdf first. Empty to return results in the order they are found. A
+         * pdf with QuerySettings::filesWithMatches is as relevant as its
+         * best page. */
+        std::string sort;
+
+        /** Defaults to unlimited unsorted file results with LIKE and five
+         * words around a match. */
+        QuerySettings() :
+            verbose(false), matches(0), fullText(false), fuzzy(0),
+            regex(false),
+            filesWithMatches(false), wordsBefore(5), wordsAfter(5), sort("") {
+        };
+    };
+
+    /** Connection settings for Database#open(). */
+    struct DatabaseSettings {
+        /** Journal mode, "delete" or "wal". Empty to keep the mode of the
+         * database file. In WAL mode queries read a consistent snapshot and
+         * aren't blocked by a running index or update. */
+        std::string journalMode;
+        /** Milliseconds to wait for a lock before failing with SQLITE_BUSY,
+         * 0 to fail immediately. */
+        int busyTimeout;
+        /** In WAL mode, checkpoint when the log has this many pages, 0 to
+         * never checkpoint automatically. */
+        int walAutocheckpoint;
+        /** Bytes of the database file read through memory mapping, 0 to
+         * read with system calls. Connections in a process share the mapped
+         * pages instead of copying them to their own caches. */
+        long long mmapSize;
+
+        /** Defaults to SQLite's defaults. */
+        DatabaseSettings() :
+            journalMode(""), busyTimeout(0), walAutocheckpoint(1000),
+            mmapSize(0) {
+        };
+    };
+
+    /** Settings for Database#index(const std::vector<std::string>&,
+     * const int, const IndexSettings&) const. */
+    struct IndexSettings {
+        /** Number of text extraction jobs, > 0. */
+        int jobs;
+        /** Extract text in worker processes instead of threads. */
+        bool processes;
+        /** Restart a worker process after this many pdfs, 0 for never. */
+        int maxDocuments;
+        /** Restart a worker process after its resident memory has grown
+         * this many megabytes, 0 for never. */
+        int maxMemory;
+        /** Kill a worker process if it takes more than this many seconds to
+         * extract a pdf, 0 for no limit. */
+        int timeout;
+        /** Name of the directory walker, see Walker::create(). */
+        std::string walker;
+        /** Number of threads reading directories, see Walker::create(). */
+        int walkJobs;
+        /** If the database is empty, build the indexes of the tables after
+         * all pdfs are inserted instead of updating them on every insert. */
+        bool bulk;
+        /** Commit after this many pdfs, 0 for only at the end. */
+        int commitEvery;
+        /** Commit when this many seconds have passed since the last commit,
+         * 0 for only at the end. */
+        int commitSeconds;
+        /** Map pdfs to memory instead of reading them, see
+         * Pdf#Pdf(const std::string&, bool). */
+        bool mmap;
+
+        /** Defaults to one thread, the boost walker and one transaction. */
+        IndexSettings() :
+            jobs(1), processes(false), maxDocuments(0), maxMemory(0),
+            timeout(0), walker("boost"), walkJobs(1), bulk(false),
+            commitEvery(0), commitSeconds(0), mmap(false) {
+        };
+    };
+
+    /** Return type for Database#index(const std::vector<std::string>&,
+     * const int, const IndexSettings&) const. */
+    struct IndexStats {
+        /** Number of pdfs inserted or updated. */
+        int pdfs;
+        /** Number of pages inserted. */
+        int pages;
+        /** Wall-clock time of indexing in seconds. */
+        double seconds;
+        /** True if indexing was stopped with Database#requestStop(). */
+        bool stopped;
+    };
+
     /** A database class.
      * Example usage:
      * @code
@@ -32,7 +157,7 @@ namespace Pdfsearch {
            if (!db.databaseCreated())
                db.createDatabase();
 
-           db.index(directories, recursionDepth);
+           db.index(directories, recursionDepth, settings);
 
            auto results(db.query(text, verbose, matches));
            // ...
@@ -45,29 +170,104 @@ namespace Pdfsearch {
     class Database {
         friend class Statement;
     public:
-        /** Keys to stmt_map returned by private function
-         * initStatements(stmt_map&).
+        /** Keys to the statements of indexing and of the schema checks,
+         * prepared once per connection.
          */
         enum class statement_key { IS_PDF_IN_DB, INSERT_PDF, INSERT_PAGE,
-            DELETE_PAGES, UPDATE_PDF, GET_ALL_PDFS1, GET_ALL_PDFS2,
-            DELETE_PDF };
+            INSERT_PAGES, DELETE_PAGES, UPDATE_PDF, GET_ALL_PDFS1, DELETE_PDF,
+            USER_VERSION, TABLE_EXISTS };
 
-        /** Return value of a private funtion initStatements(stmt_map&). */
-        typedef std::map<enum statement_key, std::unique_ptr<Statement>> stmt_map;
+        /** Number of statement keys. */
+        static const size_t STATEMENT_KEYS =
+            static_cast<size_t>(statement_key::TABLE_EXISTS) + 1;
+
+        /** Called for every result of a query, as soon as it's found. */
+        typedef std::function<void(const QueryResult& result)> result_callback;
     private:
+        /* A pdf found on the filesystem, waiting for text extraction. */
+        struct PdfFile {
+            std::string file;
+            sqlite3_int64 lastModified;
+        };
+
+        /* Text of a pdf, waiting to be written to the database. */
+        struct PdfText {
+            std::string file;
+            sqlite3_int64 lastModified;
+            std::vector<std::string> pages;
+            /* Pages folded with CaseFolder::fold(). */
+            std::vector<std::string> folded;
+        };
+
+        /* Last modification times of indexed pdfs by filename. */
+        typedef std::map<std::string, sqlite3_int64> mtime_map;
+
         std::string file;
+        DatabaseSettings settings;
         sqlite3* db;
+        /* The schema is at least SCHEMA_VERSION, checked once per
+         * connection because the version only grows. */
+        mutable bool migrated;
+        /* Statements of queries by their SQL, prepared once per
+         * connection. */
+        mutable std::map<std::string, std::unique_ptr<Statement>>
+            queryStatements;
+        /* Statements by statement_key, null until first used. */
+        mutable std::array<std::unique_ptr<Statement>, STATEMENT_KEYS>
+            statements;
+
+        // Get a prepared statement by key, preparing it the first time.
+        const Statement&
+        statement(statement_key key) const;
+
+        // Get a prepared statement of a query, preparing it the first time.
+        const Statement&
+        queryStatement(const std::string& sql) const;
+
+        // Reset the statements of queries, so that a statement left before
+        // its last row doesn't keep a read transaction open.
+        void
+        resetQueryStatements() const;
+
+        // Upgrade a database created by an older version to the current
+        // schema.
+        void
+        migrate() const;
+
+        bool
+        insertPdf(const PdfText& pdf) const;
 
         void
-        initStatements(stmt_map& statements) const;
+        createTextIndex(const std::string& table, const std::string& column,
+            const std::string& tokenizer) const;
 
+        bool
+        textIndexCreated(const std::string& table) const;
+
+        void
+        queryFullText(const std::string& query, const QuerySettings& settings,
+            const result_callback& found) const;
+
+        std::vector<std::string>
+        fuzzyTerms(const std::string& word, int distance) const;
+
+        void
+        queryRegex(const std::string& query, const QuerySettings& settings,
+            const result_callback& found) const;
+
+        // Score pages by the number of matches in their folded text, pages
+        // without matches are skipped. chunk gets the text and the folded
+        // text of a page, which point to the row being read.
         void
-        iterateDirectory(const boost::filesystem::path& p, int depth,
-            const int MAX_DEPTH, const stmt_map& statements) const;
+        queryByRelevance(const QuerySettings& settings, const Statement& pages,
+            const std::function<int(boost::string_view)>& frequency,
+            const std::function<std::string(boost::string_view,
+                boost::string_view)>& chunk,
+            const result_callback& found) const;
 
         void
-        insertPdf(const boost::filesystem::path& p,
-            const stmt_map& statements) const;
+        checkpoint(const IndexSettings& settings, int& uncommitted,
+            std::chrono::steady_clock::time_point& lastCommit) const;
 
         void
         begin() const;
@@ -85,9 +285,11 @@ namespace Pdfsearch {
         Database() : db(nullptr) {};
         /** Construct instance and open database.
          * @param file Filepath to database.
+         * @param settings Connection settings.
          * @throws A DatabaseError if can't open database.
          */
-        Database(const std::string& file);
+        Database(const std::string& file,
+            const DatabaseSettings& settings = DatabaseSettings());
         /** Non-copyable. */
         Database(const Database& other) = delete;
         /** Non-copyable. */
@@ -109,10 +311,12 @@ namespace Pdfsearch {
         open();
         /** Open database.
          * @param file Filepath to database.
+         * @param settings Connection settings.
          * @throws A DatabaseError if can't open database.
          */
         void
-        open(const std::string& file);
+        open(const std::string& file,
+            const DatabaseSettings& settings = DatabaseSettings());
         /** Close database.
          * @throws A DatabaseError if can't close database.
          */
@@ -123,6 +327,36 @@ namespace Pdfsearch {
          */
         void
         createDatabase() const;
+        /** Create the full-text index of the pages.
+         * Creates an FTS5 table indexing PlainTexts and triggers keeping it
+         * up to date, and indexes existing pages. Can be run again to
+         * rebuild the index.
+         * @throws A DatabaseError if can't create the index.
+         */
+        void
+        createFullTextIndex() const;
+        /** Check that the full-text index is created.
+         * @return True if the full-text index exists, false otherwise.
+         * @throws A DatabaseError if can't query database.
+         */
+        bool
+        fullTextIndexCreated() const;
+        /** Create the substring index of the pages.
+         * Creates an FTS5 trigram table indexing PlainTexts and triggers
+         * keeping it up to date, and indexes existing pages. Queries which
+         * have at least three characters between wildcards read only the
+         * pages having all the trigrams of the query. Can be run again to
+         * rebuild the index.
+         * @throws A DatabaseError if can't create the index.
+         */
+        void
+        createSubstringIndex() const;
+        /** Check that the substring index is created.
+         * @return True if the substring index exists, false otherwise.
+         * @throws A DatabaseError if can't query database.
+         */
+        bool
+        substringIndexCreated() const;
         /** Check that database is created.
          * @return True if database exists, false otherwise.
          * @throws A DatabaseError if can't query database.
@@ -130,6 +364,8 @@ namespace Pdfsearch {
         bool
         databaseCreated() const;
         /** Vacuum the database.
+         * Rebuilds the full-text index, if it exists, because vacuum can
+         * change the rowids of pages.
          * @throws A DatabaseError if can't vacuum the database.
          * @see http://www.sqlite.org/lang_vacuum.html
          */
@@ -139,19 +375,36 @@ namespace Pdfsearch {
          * If a pdf isn't on the filesystem anymore, it's removed from the
          * database. If pdf is newer on the filesystem than in the database,
          * pdf in the database is updated.
+         * @param settings IndexSettings::commitEvery and
+         * IndexSettings::commitSeconds are used, other settings are ignored.
          */
         void
-        update() const;
+        update(const IndexSettings& settings = IndexSettings()) const;
         /** Index pdfs.
          * Find pdfs on the filesystem and insert them to the database.
+         * Directories are walked in IndexSettings::walkJobs threads, text is
+         * extracted from pdfs in IndexSettings::jobs threads and written to
+         * the database in the calling thread. With IndexSettings::processes
+         * every extraction thread hands its pdfs to a worker process, see
+         * WorkerProcess, which is restarted if it crashes, hangs or uses too
+         * much memory.
+         * Pdfs which haven't changed since they were indexed aren't parsed.
+         * With IndexSettings::commitEvery or IndexSettings::commitSeconds
+         * pdfs are committed in batches, so a restarted index continues
+         * from the last commit.
          * @param directories Directories where to look for pdfs.
          * @param MAX_DEPTH A maximum depth to recurse in a directory.
          * Options::RECURSE_INFINITELY to recurse indefinitely, 0 to
          * not to recurse at all.
+         * @param settings Text extraction settings.
+         * @return Statistics of the run.
+         * @throws A DatabaseError if can't write to the database or
+         * std::invalid_argument if IndexSettings::walker is unknown.
          */
-        void
+        IndexStats
         index(const std::vector<std::string>& directories,
-            const int MAX_DEPTH) const;
+            const int MAX_DEPTH,
+            const IndexSettings& settings = IndexSettings()) const;
         /** Find text from pdfs.
          * @param query The phrase to search.
          * @param verbose If false, only QueryResult::file member is set in the
@@ -162,6 +415,53 @@ namespace Pdfsearch {
          */
         std::vector<QueryResult>
         query(const std::string& query, bool verbose, int matches) const;
+        /** Find text from pdfs.
+         * @param query The phrase to search, or with QuerySettings::fullText
+         * a boolean query of words and phrases, see QueryParser, or with
+         * QuerySettings::regex a regular expression, see Regexp.
+         * @param settings Query settings.
+         * @return Information about matching pages. With
+         * QuerySettings::fullText QueryResult::chunk is a snippet around the
+         * matching words.
+         * @throws A DatabaseError if QuerySettings::fullText is set and the
+         * full-text index doesn't exist or std::invalid_argument if
+         * QuerySettings::sort is unknown, the boolean query or the regular
+         * expression is invalid, both QuerySettings::fullText and
+         * QuerySettings::regex are set or QuerySettings::fuzzy is set
+         * without QuerySettings::fullText.
+         */
+        std::vector<QueryResult>
+        query(const std::string& query, const QuerySettings& settings) const;
+        /** Find text from pdfs and pass every result to a callback.
+         * Results are passed as they are found, without collecting them.
+         * QuerySettings::matches is a LIMIT of the SQL query, the rest of
+         * the pages aren't read. Sorted results are passed after every
+         * matching page is read, only QuerySettings::matches best of them
+         * are kept in memory.
+         * @param query The phrase to search, or with QuerySettings::fullText
+         * a boolean query of words and phrases, see QueryParser, or with
+         * QuerySettings::regex a regular expression, see Regexp.
+         * @param settings Query settings.
+         * @param found Called for every matching page, or pdf with
+         * QuerySettings::filesWithMatches.
+         * @throws A DatabaseError if QuerySettings::fullText is set and the
+         * full-text index doesn't exist or std::invalid_argument if
+         * QuerySettings::sort is unknown, the boolean query or the regular
+         * expression is invalid, both QuerySettings::fullText and
+         * QuerySettings::regex are set or QuerySettings::fuzzy is set
+         * without QuerySettings::fullText.
+         */
+        void
+        query(const std::string& query, const QuerySettings& settings,
+            const result_callback& found) const;
+        /** Stop a running index() or update().
+         * Pdfs being extracted are written, the transaction is committed and
+         * the function returns. If neither is running, the next call stops
+         * right away. Async-signal-safe, can be called from a signal
+         * handler.
+         */
+        static void
+        requestStop();
     };
 }
 
@@ -0,0 +1,96 @@
+#include "levenshtein.h"
+#include <algorithm>
+#include <vector>
+#include <unicode/utf8.h>
+
+/* Replaces invalid UTF-8, which is compared as a character of its own. */
+static const char32_t INVALID_CHARACTER = 0xFFFD;
+
+static const char32_t MAX_CHARACTER = 0x10FFFF;
+
+static std::u32string
+decode(const std::string& text);
+
+Pdfsearch::LevenshteinAutomaton::LevenshteinAutomaton(const std::string& word,
+        int maxDistance) :
+    word(decode(word)),
+    maxDistance(maxDistance) {
+}
+
+/* Row i of the table has the distances between the first i characters of
+ * the term and every prefix of the word. Distances are capped to
+ * maxDistance + 1, a row having only those can't get smaller. */
+bool
+Pdfsearch::LevenshteinAutomaton::match(const std::string& term,
+        size_t& deadPrefix) const {
+    const size_t size = word.size();
+    const int tooFar = maxDistance + 1;
+    std::vector<int> row(size + 1), next(size + 1);
+    for (size_t j = 0; j <= size; j++)
+        row[j] = std::min<int>(j, tooFar);
+
+    deadPrefix = std::string::npos;
+    const int32_t length = term.size();
+    for (int32_t i = 0; i < length; ) {
+        UChar32 c;
+        U8_NEXT(term.data(), i, length, c);
+        if (c < 0)
+            c = INVALID_CHARACTER;
+
+        next[0] = std::min(row[0] + 1, tooFar);
+        int least = next[0];
+        for (size_t j = 1; j <= size; j++) {
+            const int substitute = row[j - 1] +
+                (word[j - 1] == static_cast<char32_t>(c) ? 0 : 1);
+            next[j] = std::min({ substitute, row[j] + 1, next[j - 1] + 1,
+                tooFar });
+            least = std::min(least, next[j]);
+        }
+        row.swap(next);
+
+        if (least == tooFar) {
+            deadPrefix = i;
+            return false;
+        }
+    }
+
+    return row[size] <= maxDistance;
+}
+
+/* UTF-8 sorts like code points, so the last character is incremented.
+ * Surrogates aren't characters. */
+bool
+Pdfsearch::LevenshteinAutomaton::successor(const std::string& prefix,
+        std::string& next) {
+    std::u32string characters(decode(prefix));
+    while (!characters.empty() && characters.back() == MAX_CHARACTER)
+        characters.pop_back();
+    if (characters.empty())
+        return false;
+
+    char32_t& last = characters.back();
+    last = last == 0xD7FF ? 0xE000 : last + 1;
+
+    next.clear();
+    for (char32_t c : characters) {
+        char buffer[U8_MAX_LENGTH];
+        int32_t length = 0;
+        U8_APPEND_UNSAFE(buffer, length, c);
+        next.append(buffer, length);
+    }
+
+    return true;
+}
+
+static std::u32string
+decode(const std::string& text) {
+    std::u32string characters;
+    const int32_t length = text.size();
+    for (int32_t i = 0; i < length; ) {
+        UChar32 c;
+        U8_NEXT(text.data(), i, length, c);
+        characters += c < 0 ? INVALID_CHARACTER : c;
+    }
+
+    return characters;
+}
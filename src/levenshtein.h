@@ -0,0 +1,61 @@
+#ifndef LEVENSHTEIN_H
+    #define LEVENSHTEIN_H
+
+#include <cstddef>
+#include <string>
+
+namespace Pdfsearch {
+    /** A class to find the terms within an edit distance of a word.
+     * The automaton reads a term a character at a time, keeping a row of
+     * the Levenshtein distance table as its state, so a prefix of a term
+     * which can't be extended to a match is known as soon as it's read.
+     * Terms of a sorted dictionary having such a prefix can be skipped, so
+     * only a small part of a big dictionary is read. Example usage:
+     * @code
+       Pdfsearch::LevenshteinAutomaton automaton("kernel", 1);
+       std::string from;
+       // For every term >= from in order:
+           size_t dead;
+           if (automaton.match(term, dead))
+               // Found a term.
+           if (dead != std::string::npos &&
+                   !automaton.successor(term.substr(0, dead), from))
+               // No more terms.
+           // Else continue from the first term >= from.
+       @endcode
+     */
+    class LevenshteinAutomaton {
+    private:
+        std::u32string word;
+        const int maxDistance;
+    public:
+        /** Constructor.
+         * @param word UTF-8 word to compare terms to.
+         * @param maxDistance Largest number of inserted, deleted and
+         * substituted characters, >= 0.
+         */
+        LevenshteinAutomaton(const std::string& word, int maxDistance);
+
+        /** Compare a term to the word.
+         * @param term UTF-8 term.
+         * @param deadPrefix Set to the length in bytes of the shortest
+         * prefix of the term which no term within the distance starts with,
+         * std::string::npos if there's no such prefix.
+         * @return True if the term is within the distance of the word,
+         * false otherwise.
+         */
+        bool
+        match(const std::string& term, size_t& deadPrefix) const;
+
+        /** Get the least string greater than every string having a prefix.
+         * @param prefix Non-empty UTF-8 prefix.
+         * @param next Set to the string.
+         * @return True if there's such a string, false if the prefix has
+         * only the largest characters.
+         */
+        static bool
+        successor(const std::string& prefix, std::string& next);
+    };
+}
+
+#endif // LEVENSHTEIN_H
@@ -1,14 +1,48 @@
+#include <signal.h>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include "options.h"
 #include "database.h"
+#include "queryserver.h"
+#include "workerprocess.h"
+
+/* Server stopped by the signal handler. */
+static Pdfsearch::QueryServer* runningServer = nullptr;
+
+static Pdfsearch::QuerySettings
+querySettings(const Pdfsearch::Options& options);
+
+template <typename Searcher> static bool
+runQueries(Searcher& searcher, const Pdfsearch::Options& options);
+
+template <typename Searcher> static void
+runQuery(Searcher& searcher, const std::string& query,
+    const Pdfsearch::QuerySettings& settings);
+
+template <typename Searcher> static bool
+runBatch(Searcher& searcher, const Pdfsearch::QuerySettings& settings,
+    char separator);
+
+static void
+printResult(const Pdfsearch::QueryResult& result, int number, bool verbose);
 
 static void
-printResults(const std::vector<Pdfsearch::QueryResult>& results, bool verbose);
+printStats(const Pdfsearch::IndexStats& stats);
+
+static void
+stopOnSignals(void (*handler)(int));
+
+static void
+stopHandler(int signal);
+
+static void
+stopServerHandler(int signal);
 
 int
 main(int argc, char** argv) {
+    Pdfsearch::WorkerProcess::runIfWorker(argc, argv);
     Pdfsearch::Options options(argc, argv);
     try {
         options.getopt();
@@ -19,7 +53,18 @@ main(int argc, char** argv) {
         }
         options.validate();
 
-        Pdfsearch::Database db(options.getDatabase());
+        /* Queries are sent to a server, which has the database open. */
+        if (!options.getConnect().empty()) {
+            Pdfsearch::QueryClient client(options.getConnect());
+            return runQueries(client, options) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        Pdfsearch::DatabaseSettings databaseSettings;
+        databaseSettings.journalMode = options.getJournalMode();
+        databaseSettings.busyTimeout = options.getBusyTimeout();
+        databaseSettings.walAutocheckpoint = options.getWalAutocheckpoint();
+
+        Pdfsearch::Database db(options.getDatabase(), databaseSettings);
         if (!db.databaseCreated()) {
             if (options.getIndex())
                 db.createDatabase();
@@ -29,18 +74,60 @@ main(int argc, char** argv) {
             }
         }
 
-        std::string query = options.getQuery();
-        if (!query.empty()) {
-            auto results(
-                db.query(query, options.getVerbose(), options.getMatches()));
-            printResults(results, options.getVerbose());
+        if (!options.getQuery().empty() || options.getBatch()) {
+            if (!runQueries(db, options))
+                return EXIT_FAILURE;
+        }
+        else if (!options.getServe().empty()) {
+            Pdfsearch::QueryServer server(options.getServe(),
+                options.getDatabase(), databaseSettings, options.getJobs());
+            runningServer = &server;
+            stopOnSignals(stopServerHandler);
+            server.run();
+            runningServer = nullptr;
+        }
+        else if (options.getIndex()) {
+            Pdfsearch::IndexSettings settings;
+            settings.jobs = options.getJobs();
+            settings.processes = options.getProcesses();
+            settings.maxDocuments = options.getMaxDocuments();
+            settings.maxMemory = options.getMaxMemory();
+            settings.timeout = options.getTimeout();
+            settings.walker = options.getWalker();
+            settings.walkJobs = options.getWalkJobs();
+            settings.bulk = options.getBulk();
+            settings.commitEvery = options.getCommitEvery();
+            settings.commitSeconds = options.getCommitSeconds();
+            settings.mmap = options.getMmap();
+
+            stopOnSignals(stopHandler);
+            auto stats(db.index(options.getDirectories(),
+                options.getRecursion(), settings));
+            if (options.getVerbose())
+                printStats(stats);
+            if (stats.stopped) {
+                std::cerr << "indexing stopped, index again to continue" <<
+                    std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if (options.getUpdate()) {
+            Pdfsearch::IndexSettings settings;
+            settings.commitEvery = options.getCommitEvery();
+            settings.commitSeconds = options.getCommitSeconds();
+            settings.mmap = options.getMmap();
+
+            stopOnSignals(stopHandler);
+            db.update(settings);
         }
-        else if (options.getIndex())
-            db.index(options.getDirectories(), options.getRecursion());
-        else if (options.getUpdate())
-            db.update();
         else if (options.getVacuum())
             db.vacuum();
+        else {
+            if (options.getCreateFullText())
+                db.createFullTextIndex();
+            if (options.getCreateSubstring())
+                db.createSubstringIndex();
+        }
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -50,16 +137,113 @@ main(int argc, char** argv) {
     return EXIT_SUCCESS;
 }
 
-static void
-printResults(const std::vector<Pdfsearch::QueryResult>& results, bool verbose) {
-    int i = 1;
-    for (const auto& r : results) {
-        if (verbose) {
-            std::cout.width(3);
-            std::cout << std::left << i++ << " " << r.file << " [" <<
-                r.page << "/" << r.pages << "]: " << r.chunk << std::endl;
+static Pdfsearch::QuerySettings
+querySettings(const Pdfsearch::Options& options) {
+    Pdfsearch::QuerySettings settings;
+    settings.verbose = options.getVerbose();
+    settings.matches = options.getMatches();
+    settings.fullText = options.getFullText();
+    settings.fuzzy = options.getFuzzy();
+    settings.regex = options.getRegularExpression();
+    settings.filesWithMatches = options.getFilesWithMatches();
+    settings.wordsBefore = options.getBeforeContext();
+    settings.wordsAfter = options.getAfterContext();
+    settings.sort = options.getSort();
+
+    return settings;
+}
+
+/* Run the query option or the batch read from standard input on a database
+ * or a client of a server.
+ * @return False if a query of the batch failed. */
+template <typename Searcher> static bool
+runQueries(Searcher& searcher, const Pdfsearch::Options& options) {
+    if (!options.getQuery().empty()) {
+        runQuery(searcher, options.getQuery(), querySettings(options));
+        return true;
+    }
+
+    return runBatch(searcher, querySettings(options),
+        options.getNullSeparated() ? '\0' : '\n');
+}
+
+/* Results are printed as soon as they are found, sorted results after every
+ * page is read. */
+template <typename Searcher> static void
+runQuery(Searcher& searcher, const std::string& query,
+        const Pdfsearch::QuerySettings& settings) {
+    int number = 1;
+    searcher.query(query, settings, [&](const Pdfsearch::QueryResult& r) {
+        printResult(r, number++,
+            settings.verbose && !settings.filesWithMatches);
+    });
+}
+
+/* Queries are run on the same connection, which keeps its prepared
+ * statements and page cache, or sent to the same server. The results of
+ * every query, none for an empty or a failed query, are followed by an empty
+ * line, or by NUL if the queries are separated by NUL, and flushed. A failed
+ * query doesn't stop the batch.
+ * @return False if a query failed. */
+template <typename Searcher> static bool
+runBatch(Searcher& searcher, const Pdfsearch::QuerySettings& settings,
+        char separator) {
+    bool ok = true;
+    std::string query;
+    while (std::getline(std::cin, query, separator)) {
+        try {
+            if (!query.empty())
+                runQuery(searcher, query, settings);
+        }
+        catch (const std::exception& e) {
+            std::cerr << query << ": " << e.what() << std::endl;
+            ok = false;
         }
-        else
-            std::cout << r.file << std::endl;
+        std::cout << separator << std::flush;
+    }
+
+    return ok;
+}
+
+static void
+printResult(const Pdfsearch::QueryResult& r, int number, bool verbose) {
+    if (verbose) {
+        std::cout.width(3);
+        std::cout << std::left << number << " " << r.file << " [" <<
+            r.page << "/" << r.pages << "]: " << r.chunk << std::endl;
     }
+    else
+        std::cout << r.file << std::endl;
+}
+
+static void
+printStats(const Pdfsearch::IndexStats& stats) {
+    std::cout << stats.pdfs << " pdfs, " << stats.pages << " pages in " <<
+        stats.seconds << " s";
+    if (stats.seconds > 0)
+        std::cout << " (" << stats.pages / stats.seconds << " pages/s)";
+    std::cout << std::endl;
+}
+
+/* The first SIGINT or SIGTERM commits and stops indexing or stops the server,
+ * the second one terminates. */
+static void
+stopOnSignals(void (*handler)(int)) {
+    struct sigaction action;
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+static void
+stopHandler(int) {
+    Pdfsearch::Database::requestStop();
+}
+
+static void
+stopServerHandler(int) {
+    if (runningServer)
+        runningServer->stop();
 }
@@ -12,17 +12,44 @@
 Pdfsearch::Options::Options(int argc, char** argv) :
         argc(argc),
         argv(nullptr),
+        afterContext(5),
+        batch(false),
+        beforeContext(5),
+        bulk(false),
+        commitEvery(0),
+        commitSeconds(0),
+        busyTimeout(5000),
         config(CONFIG_FILE),
+        connect(""),
+        createFullText(false),
+        createSubstring(false),
         database(DATABASE_FILE),
         directories({ "." }),
+        filesWithMatches(false),
+        fullText(false),
+        fuzzy(0),
         help(false),
         index(false),
+        journalMode(""),
+        jobs(1),
         matches(UNLIMITED_MATCHES),
+        maxDocuments(0),
+        maxMemory(0),
+        mmap(false),
+        nullSeparated(false),
+        processes(false),
         query(""),
         recursion(RECURSE_INFINITELY),
+        regularExpression(false),
+        serve(""),
+        sort(""),
+        timeout(0),
         update(false),
         vacuum(false),
-        verbose(false) {
+        verbose(false),
+        walAutocheckpoint(1000),
+        walker("boost"),
+        walkJobs(1) {
     this->argv = new char*[argc];
     size_t i = 0;
     try {
@@ -79,34 +106,119 @@ Pdfsearch::Options::getopt() {
     parseConfig();
     optind = 1;
 
-    const char* shortopts = ":ac:d:hi::m:q:r:uv";
+    /* Values for long options without a short option. */
+    enum {
+        BATCH = 256,
+        BULK,
+        BUSY_TIMEOUT,
+        COMMIT_EVERY,
+        COMMIT_SECONDS,
+        CONNECT,
+        CREATE_FULL_TEXT,
+        CREATE_SUBSTRING_INDEX,
+        FUZZY,
+        MAX_DOCUMENTS,
+        MAX_MEMORY,
+        MMAP,
+        SERVE,
+        TIMEOUT,
+        WAL_AUTOCHECKPOINT,
+        WALK_JOBS
+    };
+    const char* shortopts = ":aA:B:c:d:Efhi::j:J:lm:Pq:r:s:uvw:z";
     const struct option longopts[] = {
-        { "vacuum",      0, 0, 'a' },
-        { "config",      1, 0, 'c' },
-        { "database",    1, 0, 'd' },
-        { "help",        0, 0, 'h' },
-        { "index",       2, 0, 'i' },
-        { "matches",     1, 0, 'm' },
-        { "query",       1, 0, 'q' },
-        { "recursion",   1, 0, 'r' },
-        { "update",      0, 0, 'u' },
-        { "verbose",     0, 0, 'v' },
+        { "vacuum",        0, 0, 'a' },
+        { "after-context", 1, 0, 'A' },
+        { "before-context", 1, 0, 'B' },
+        { "batch",         0, 0, BATCH },
+        { "bulk",          0, 0, BULK },
+        { "busy-timeout",  1, 0, BUSY_TIMEOUT },
+        { "commit-every",  1, 0, COMMIT_EVERY },
+        { "commit-seconds", 1, 0, COMMIT_SECONDS },
+        { "config",        1, 0, 'c' },
+        { "connect",       1, 0, CONNECT },
+        { "create-full-text", 0, 0, CREATE_FULL_TEXT },
+        { "create-substring-index", 0, 0, CREATE_SUBSTRING_INDEX },
+        { "database",      1, 0, 'd' },
+        { "regex",         0, 0, 'E' },
+        { "files-with-matches", 0, 0, 'l' },
+        { "full-text",     0, 0, 'f' },
+        { "fuzzy",         1, 0, FUZZY },
+        { "help",          0, 0, 'h' },
+        { "index",         2, 0, 'i' },
+        { "jobs",          1, 0, 'j' },
+        { "journal-mode",  1, 0, 'J' },
+        { "matches",       1, 0, 'm' },
+        { "null",          0, 0, 'z' },
+        { "max-documents", 1, 0, MAX_DOCUMENTS },
+        { "max-memory",    1, 0, MAX_MEMORY },
+        { "mmap",          0, 0, MMAP },
+        { "processes",     0, 0, 'P' },
+        { "query",         1, 0, 'q' },
+        { "recursion",     1, 0, 'r' },
+        { "serve",         1, 0, SERVE },
+        { "sort",          1, 0, 's' },
+        { "timeout",       1, 0, TIMEOUT },
+        { "update",        0, 0, 'u' },
+        { "verbose",       0, 0, 'v' },
+        { "walker",        1, 0, 'w' },
+        { "wal-autocheckpoint", 1, 0, WAL_AUTOCHECKPOINT },
+        { "walk-jobs",     1, 0, WALK_JOBS },
         { 0, 0, 0, 0 }
     };
 
-    char c;
+    int c;
     while ((c = getopt_long(argc, argv, shortopts, longopts, 0)) != -1) {
         std::ostringstream error;
         switch (c) {
             case 'a':
                 vacuum = true;
                 break;
+            case 'A':
+                afterContext = readInt(optarg, "after-context");
+                break;
+            case 'B':
+                beforeContext = readInt(optarg, "before-context");
+                break;
+            case BATCH:
+                batch = true;
+                break;
+            case BULK:
+                bulk = true;
+                break;
+            case BUSY_TIMEOUT:
+                busyTimeout = readInt(optarg, "busy-timeout");
+                break;
+            case COMMIT_EVERY:
+                commitEvery = readInt(optarg, "commit-every");
+                break;
+            case COMMIT_SECONDS:
+                commitSeconds = readInt(optarg, "commit-seconds");
+                break;
             /* Config already handled, but the option still exists in argv,
              * don't remove. */
             case 'c': break;
+            case CONNECT:
+                connect = optarg;
+                break;
+            case CREATE_FULL_TEXT:
+                createFullText = true;
+                break;
+            case CREATE_SUBSTRING_INDEX:
+                createSubstring = true;
+                break;
             case 'd':
                 database = optarg;
                 break;
+            case 'E':
+                regularExpression = true;
+                break;
+            case 'f':
+                fullText = true;
+                break;
+            case FUZZY:
+                fuzzy = readInt(optarg, "fuzzy");
+                break;
             case 'h':
                 help = true;
                 /* Ignore other options. */
@@ -123,21 +235,63 @@ Pdfsearch::Options::getopt() {
                 }
                 parseDirectories(optarg);
                 break;
+            case 'j':
+                jobs = readInt(optarg, "jobs");
+                break;
+            case 'J':
+                journalMode = optarg;
+                break;
+            case 'l':
+                filesWithMatches = true;
+                break;
             case 'm':
                 matches = readInt(optarg, "matches");
                 break;
+            case MAX_DOCUMENTS:
+                maxDocuments = readInt(optarg, "max-documents");
+                break;
+            case MAX_MEMORY:
+                maxMemory = readInt(optarg, "max-memory");
+                break;
+            case MMAP:
+                mmap = true;
+                break;
+            case 'P':
+                processes = true;
+                break;
             case 'q':
                 query = optarg;
                 break;
             case 'r':
                 recursion = readInt(optarg, "recursion");
                 break;
+            case 's':
+                sort = optarg;
+                break;
+            case SERVE:
+                serve = optarg;
+                break;
+            case TIMEOUT:
+                timeout = readInt(optarg, "timeout");
+                break;
             case 'u':
                 update = true;
                 break;
             case 'v':
                 verbose = true;
                 break;
+            case 'w':
+                walker = optarg;
+                break;
+            case WAL_AUTOCHECKPOINT:
+                walAutocheckpoint = readInt(optarg, "wal-autocheckpoint");
+                break;
+            case WALK_JOBS:
+                walkJobs = readInt(optarg, "walk-jobs");
+                break;
+            case 'z':
+                nullSeparated = true;
+                break;
             case '?':
                 error << "invalid option '" << static_cast<char>(optopt) << "'";
                 throw std::invalid_argument(error.str());
@@ -153,9 +307,12 @@ Pdfsearch::Options::getopt() {
 
 void
 Pdfsearch::Options::validate() const {
-    if (!index && query.empty() && !vacuum && !update) {
-        throw std::invalid_argument("either index, query, update or vacuum "
-            "option must be selected");
+    const bool create = createFullText || createSubstring;
+    if (!index && query.empty() && !batch && serve.empty() && !vacuum &&
+            !update && !create) {
+        throw std::invalid_argument("either index, query, batch, serve, "
+            "update, vacuum, create-full-text or create-substring-index option "
+            "must be selected");
     }
 
     if (vacuum && index)
@@ -176,9 +333,73 @@ Pdfsearch::Options::validate() const {
     if (update && index)
         throw std::invalid_argument("index and update options are mutually "
             "exclusive");
+    if (fuzzy != 0 && !fullText)
+        throw std::invalid_argument("fuzzy option requires full-text option");
+    if (fullText && regularExpression)
+        throw std::invalid_argument("full-text and regex options are "
+            "mutually exclusive");
+    if (batch && !query.empty())
+        throw std::invalid_argument("query and batch options are mutually "
+            "exclusive");
+    if (batch && (index || update || vacuum || create))
+        throw std::invalid_argument("batch option can't be used with index, "
+            "update, vacuum, create-full-text or create-substring-index "
+            "options");
+    if (nullSeparated && !batch)
+        throw std::invalid_argument("null option requires batch option");
+    if (!serve.empty() && (index || !query.empty() || batch || update ||
+            vacuum || create)) {
+        throw std::invalid_argument("serve option can't be used with index, "
+            "query, batch, update, vacuum, create-full-text or "
+            "create-substring-index options");
+    }
+    if (!connect.empty() && query.empty() && !batch)
+        throw std::invalid_argument("connect option requires query or batch "
+            "option");
+    if (create && (index || update || vacuum || !query.empty()))
+        throw std::invalid_argument("create-full-text and "
+            "create-substring-index options can't be used with index, query, "
+            "update or vacuum options");
 
     if (matches < UNLIMITED_MATCHES)
         throw std::invalid_argument("matches argument is negative");
+    if (jobs < 1)
+        throw std::invalid_argument("jobs argument is not positive");
+    if (afterContext < 0)
+        throw std::invalid_argument("after-context argument is negative");
+    if (beforeContext < 0)
+        throw std::invalid_argument("before-context argument is negative");
+    if (maxDocuments < 0)
+        throw std::invalid_argument("max-documents argument is negative");
+    if (maxMemory < 0)
+        throw std::invalid_argument("max-memory argument is negative");
+    if (timeout < 0)
+        throw std::invalid_argument("timeout argument is negative");
+    if (busyTimeout < 0)
+        throw std::invalid_argument("busy-timeout argument is negative");
+    if (walAutocheckpoint < 0)
+        throw std::invalid_argument("wal-autocheckpoint argument is negative");
+    if (!journalMode.empty() && journalMode != "delete" && journalMode != "wal")
+        throw std::invalid_argument("journal-mode argument is not delete or "
+            "wal");
+    if (commitEvery < 0)
+        throw std::invalid_argument("commit-every argument is negative");
+    if (commitSeconds < 0)
+        throw std::invalid_argument("commit-seconds argument is negative");
+    if (fuzzy < 0)
+        throw std::invalid_argument("fuzzy argument is negative");
+    if (!sort.empty() && sort != "relevance" && sort != "path" &&
+            sort != "mtime") {
+        throw std::invalid_argument("sort argument is not relevance, path or "
+            "mtime");
+    }
+    if (walker != "boost" && walker != "getdents")
+        throw std::invalid_argument("walker argument is not boost or getdents");
+    if (walkJobs < 1)
+        throw std::invalid_argument("walk-jobs argument is not positive");
+    if (walkJobs > 1 && walker != "getdents")
+        throw std::invalid_argument("walk-jobs argument requires getdents "
+            "walker");
 }
 
 void
@@ -191,11 +412,43 @@ Pdfsearch::Options::parseConfig() {
 
     static regex_constants::syntax_option_type flags =
         regex::perl | regex::icase;
+    static const regex afterContextPattern(
+        "^after_context\\s*=\\s*(\\d+)$", flags);
+    static const regex beforeContextPattern(
+        "^before_context\\s*=\\s*(\\d+)$", flags);
+    static const regex bulkPattern("^bulk\\s*=\\s*(yes|no)$",           flags);
+    static const regex busyTimeoutPattern("^busy_timeout\\s*=\\s*(\\d+)$",
+        flags);
+    static const regex commitEveryPattern("^commit_every\\s*=\\s*(\\d+)$",
+        flags);
+    static const regex commitSecondsPattern(
+        "^commit_seconds\\s*=\\s*(\\d+)$", flags);
     static const regex databasePattern("^database\\s*=\\s*(.+)$",       flags);
     static const regex directoriesPattern("^directories\\s*=\\s*(.+)$", flags);
+    static const regex filesWithMatchesPattern(
+        "^files_with_matches\\s*=\\s*(yes|no)$", flags);
+    static const regex fullTextPattern("^full_text\\s*=\\s*(yes|no)$", flags);
+    static const regex fuzzyPattern("^fuzzy\\s*=\\s*(\\d+)$",           flags);
+    static const regex jobsPattern("^jobs\\s*=\\s*(\\d+)$",             flags);
     static const regex matchesPattern("^matches\\s*=\\s*(\\d+)$",       flags);
+    static const regex journalModePattern(
+        "^journal_mode\\s*=\\s*(delete|wal)$", flags);
+    static const regex maxDocumentsPattern("^max_documents\\s*=\\s*(\\d+)$",
+        flags);
+    static const regex maxMemoryPattern("^max_memory\\s*=\\s*(\\d+)$", flags);
+    static const regex mmapPattern("^mmap\\s*=\\s*(yes|no)$",           flags);
+    static const regex processesPattern("^processes\\s*=\\s*(yes|no)$", flags);
     static const regex recursionPattern("^recursion\\s*=\\s*(-?\\d+)$", flags);
+    static const regex regexPattern("^regex\\s*=\\s*(yes|no)$",         flags);
+    static const regex sortPattern(
+        "^sort\\s*=\\s*(relevance|path|mtime)$", flags);
+    static const regex timeoutPattern("^timeout\\s*=\\s*(\\d+)$",       flags);
     static const regex verbosePattern("^verbose\\s*=\\s*(yes|no)$",     flags);
+    static const regex walkerPattern("^walker\\s*=\\s*(boost|getdents)$",
+        flags);
+    static const regex walAutocheckpointPattern(
+        "^wal_autocheckpoint\\s*=\\s*(\\d+)$", flags);
+    static const regex walkJobsPattern("^walk_jobs\\s*=\\s*(\\d+)$", flags);
     static const regex ignorePattern("^#.*|\\s*$",                      flags);
 
     std::string line;
@@ -203,35 +456,68 @@ Pdfsearch::Options::parseConfig() {
     file.exceptions(std::fstream::badbit);
     while (std::getline(file, line).good()) {
         smatch m;
-        std::istringstream integer;
         std::ostringstream error;
 
-        if (regex_match(line, m, databasePattern))
+        if (regex_match(line, m, afterContextPattern))
+            afterContext = readConfigInt(m[1], "after_context");
+        else if (regex_match(line, m, beforeContextPattern))
+            beforeContext = readConfigInt(m[1], "before_context");
+        else if (regex_match(line, m, bulkPattern))
+            bulk = readConfigBool(m[1]);
+        else if (regex_match(line, m, busyTimeoutPattern))
+            busyTimeout = readConfigInt(m[1], "busy_timeout");
+        else if (regex_match(line, m, commitEveryPattern))
+            commitEvery = readConfigInt(m[1], "commit_every");
+        else if (regex_match(line, m, commitSecondsPattern))
+            commitSeconds = readConfigInt(m[1], "commit_seconds");
+        else if (regex_match(line, m, databasePattern))
             database = m[1];
         else if (regex_match(line, m, directoriesPattern))
             parseDirectories(m[1].str().c_str());
-        else if (regex_match(line, m, matchesPattern)) {
-            integer.str(m[1]);
-            if ((integer >> matches).fail()) {
-                error << "matches option '" << integer.str() <<
-                    "' doesn't fit to int";
-                throw std::runtime_error(error.str());
-            }
+        else if (regex_match(line, m, filesWithMatchesPattern))
+            filesWithMatches = readConfigBool(m[1]);
+        else if (regex_match(line, m, fullTextPattern))
+            fullText = readConfigBool(m[1]);
+        else if (regex_match(line, m, fuzzyPattern))
+            fuzzy = readConfigInt(m[1], "fuzzy");
+        else if (regex_match(line, m, journalModePattern)) {
+            journalMode = m[1];
+            std::transform(journalMode.begin(), journalMode.end(),
+                journalMode.begin(), ::tolower);
         }
-        else if (regex_match(line, m, recursionPattern)) {
-            integer.str(m[1]);
-            if ((integer >> recursion).fail()) {
-                error << "recursion option '" << integer.str() <<
-                    "' doesn't fit to int";
-                throw std::runtime_error(error.str());
-            }
+        else if (regex_match(line, m, jobsPattern))
+            jobs = readConfigInt(m[1], "jobs");
+        else if (regex_match(line, m, matchesPattern))
+            matches = readConfigInt(m[1], "matches");
+        else if (regex_match(line, m, maxDocumentsPattern))
+            maxDocuments = readConfigInt(m[1], "max_documents");
+        else if (regex_match(line, m, maxMemoryPattern))
+            maxMemory = readConfigInt(m[1], "max_memory");
+        else if (regex_match(line, m, mmapPattern))
+            mmap = readConfigBool(m[1]);
+        else if (regex_match(line, m, processesPattern))
+            processes = readConfigBool(m[1]);
+        else if (regex_match(line, m, recursionPattern))
+            recursion = readConfigInt(m[1], "recursion");
+        else if (regex_match(line, m, regexPattern))
+            regularExpression = readConfigBool(m[1]);
+        else if (regex_match(line, m, sortPattern)) {
+            sort = m[1];
+            std::transform(sort.begin(), sort.end(), sort.begin(), ::tolower);
         }
-        else if (regex_match(line, m, verbosePattern)) {
-            std::string lowercaseM(m[1].str());
-            std::transform(lowercaseM.begin(), lowercaseM.end(),
-                lowercaseM.begin(), ::tolower);
-            verbose = lowercaseM == "yes";
+        else if (regex_match(line, m, timeoutPattern))
+            timeout = readConfigInt(m[1], "timeout");
+        else if (regex_match(line, m, verbosePattern))
+            verbose = readConfigBool(m[1]);
+        else if (regex_match(line, m, walkerPattern)) {
+            walker = m[1];
+            std::transform(walker.begin(), walker.end(), walker.begin(),
+                ::tolower);
         }
+        else if (regex_match(line, m, walAutocheckpointPattern))
+            walAutocheckpoint = readConfigInt(m[1], "wal_autocheckpoint");
+        else if (regex_match(line, m, walkJobsPattern))
+            walkJobs = readConfigInt(m[1], "walk_jobs");
         else if (regex_match(line, ignorePattern))
             ;
         else {
@@ -253,16 +539,63 @@ Pdfsearch::Options::printHelp() {
         "       " << PACKAGE << " -q <STRING>"                    << endl <<
         "       " << PACKAGE << " -i<DIR>,..."                    << endl <<
         "   -a, --vacuum              vacuum database"            << endl <<
+        "   -A, --after-context=N     print N words after match"  << endl <<
+        "   -B, --before-context=N    print N words before match" << endl <<
+        "       --batch               run queries from stdin,"    << endl <<
+        "                             one per line"               << endl <<
+        "       --bulk                build table indexes after"  << endl <<
+        "                             first index"                << endl <<
         "   -c, --config=FILE         configuration file"         << endl <<
+        "       --connect=SOCKET      send queries to a server"   << endl <<
+        "       --busy-timeout=N      wait N ms for a locked"     << endl <<
+        "                             database"                   << endl <<
+        "       --commit-every=N      commit after every N pdfs"  << endl <<
+        "       --commit-seconds=N    commit every N seconds"     << endl <<
+        "       --create-full-text    create full-text index"     << endl <<
+        "       --create-substring-index"                         << endl <<
+        "                             create substring index"     << endl <<
         "   -d, --database=FILE       database file"              << endl <<
+        "   -E, --regex               query with a regular"       << endl <<
+        "                             expression"                 << endl <<
+        "   -f, --full-text           query words with the"       << endl <<
+        "                             full-text index"            << endl <<
+        "       --fuzzy=N             also find words within N"   << endl <<
+        "                             edits with --full-text"     << endl <<
         "   -h, --help"                                           << endl <<
         "   -i, --index=[DIR],...     index database searching"   << endl <<
         "                             pdfs from DIRs"             << endl <<
+        "   -j, --jobs=N              extract text in N threads," << endl <<
+        "                             answer N queries at a time" << endl <<
+        "   -J, --journal-mode=MODE   delete or wal journal"      << endl <<
+        "   -l, --files-with-matches  print every matching pdf"   << endl <<
+        "                             once"                       << endl <<
         "   -m, --matches=N           find N matches for query"   << endl <<
+        "       --max-documents=N     restart a worker process"   << endl <<
+        "                             after N pdfs"               << endl <<
+        "       --max-memory=N        restart a worker process"   << endl <<
+        "                             after N MB memory growth"   << endl <<
+        "       --mmap                map pdfs to memory when"    << endl <<
+        "                             indexing"                   << endl <<
+        "   -P, --processes           extract text in worker"     << endl <<
+        "                             processes"                  << endl <<
         "   -q, --query=STRING        query the database"         << endl <<
         "   -r, --recursion=N         recurse N directories deep" << endl <<
+        "   -s, --sort=ORDER          sort results by relevance," << endl <<
+        "                             path or mtime"              << endl <<
+        "       --serve=SOCKET        answer queries on SOCKET"   << endl <<
+        "       --timeout=N           kill a worker process if"   << endl <<
+        "                             a pdf takes N seconds"      << endl <<
         "   -u, --update              update the database"        << endl <<
-        "   -v, --verbose             print query context"        << endl;
+        "   -v, --verbose             print query context"        << endl <<
+        "       --wal-autocheckpoint=N"                           << endl <<
+        "                             checkpoint WAL after N"     << endl <<
+        "                             pages"                      << endl <<
+        "   -w, --walker=NAME         find pdfs with boost or"    << endl <<
+        "                             getdents walker"            << endl <<
+        "       --walk-jobs=N         read directories in N"      << endl <<
+        "                             threads, needs getdents"    << endl <<
+        "   -z, --null                separate batch queries"     << endl <<
+        "                             with NUL"                   << endl;
     cout << help.str();
 }
 
@@ -300,6 +633,25 @@ Pdfsearch::Options::parseDirectories(const char* dirs) {
         directories.push_back(d);
 }
 
+int
+Pdfsearch::Options::readConfigInt(const std::string& s, const char* optionName) {
+    std::istringstream integer(s);
+    int i;
+    if ((integer >> i).fail()) {
+        std::ostringstream error;
+        error << optionName << " option '" << s << "' doesn't fit to int";
+        throw std::runtime_error(error.str());
+    }
+
+    return i;
+}
+
+bool
+Pdfsearch::Options::readConfigBool(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s == "yes";
+}
+
 int
 Pdfsearch::Options::readInt(const char* s, const char* optionName) {
     std::ostringstream error;
@@ -21,28 +21,88 @@ namespace Pdfsearch {
     private:
         int argc;
         char** argv;
+        /* Words after a match in query context. [0, Inf]. */
+        int afterContext;
+        /* Run queries read from standard input. */
+        bool batch;
+        /* Words before a match in query context. [0, Inf]. */
+        int beforeContext;
+        /* Build table indexes after a first time index. */
+        bool bulk;
+        /* Commit after this many pdfs, 0 for only at the end. [0, Inf]. */
+        int commitEvery;
+        /* Commit after this many seconds, 0 for only at the end. [0, Inf]. */
+        int commitSeconds;
+        /* Milliseconds to wait for a locked database. [0, Inf]. */
+        int busyTimeout;
         std::string config;
+        /* Socket of a server to send queries to. */
+        std::string connect;
+        /* Create the full-text index of an existing database. */
+        bool createFullText;
+        /* Create the substring index of an existing database. */
+        bool createSubstring;
         std::string database;
         /* Directories to search for pdfs. */
         std::vector<std::string> directories;
+        /* Print every matching pdf once. */
+        bool filesWithMatches;
+        /* Query words with the full-text index. */
+        bool fullText;
+        /* Edit distance of terms found for a word of a full-text query.
+         * [0, Inf]. */
+        int fuzzy;
         bool help;
         /* Index database. */
         bool index;
+        /* Journal mode of the database, "delete", "wal" or empty to keep
+         * the current mode. */
+        std::string journalMode;
+        /* Number of text extraction threads when indexing, or of queries
+         * answered at a time. [1, Inf]. */
+        int jobs;
         /* Number of matches to return for query. [UNLIMITED_MATCHES, Inf]. */
         int matches;
+        /* Restart a worker process after this many pdfs, 0 for never.
+         * [0, Inf]. */
+        int maxDocuments;
+        /* Restart a worker process after its memory has grown this many
+         * megabytes, 0 for never. [0, Inf]. */
+        int maxMemory;
+        /* Map pdfs to memory when indexing. */
+        bool mmap;
+        /* Queries read in batch are separated by NUL, not by newline. */
+        bool nullSeparated;
+        /* Extract text in worker processes. */
+        bool processes;
         std::string query;
         /* Level of recursion to directory.
          * With a negative value recurses infinitely, 0 not at all, 1
          * directories in this directory, etc.
          * [-Inf, Inf]. */
         int recursion;
+        /* Query with a regular expression. */
+        bool regularExpression;
+        /* Socket to serve queries on. */
+        std::string serve;
+        /* Order of query results, "relevance", "path", "mtime" or empty
+         * for the order they are found. */
+        std::string sort;
+        /* Seconds to wait for a worker process to extract a pdf, 0 for no
+         * limit. [0, Inf]. */
+        int timeout;
         /* Update database. */
         bool update;
         /* Vacuum the database. */
         bool vacuum;
-        /* Print context for the match.
-         * TODO Use -B -A like in grep, characters before and after match. */
+        /* Print context for the match. */
         bool verbose;
+        /* WAL pages before an automatic checkpoint, 0 for never. [0, Inf]. */
+        int walAutocheckpoint;
+        /* Directory walker when indexing, "boost" or "getdents". */
+        std::string walker;
+        /* Number of threads reading directories when indexing. [1, Inf]. */
+        int walkJobs;
 
         void
         parseDirectories(const char* directories);
@@ -55,6 +115,12 @@ namespace Pdfsearch {
 
         static int
         readInt(const char* s, const char* optionName);
+
+        static int
+        readConfigInt(const std::string& s, const char* optionName);
+
+        static bool
+        readConfigBool(std::string s);
     public:
         enum {
             /** Return all the matches. */
@@ -66,17 +132,44 @@ namespace Pdfsearch {
          * @param argc Number of command line arguments.
          * @param argv Command line arguments.
          * <pre> Sets defaults:
+         *     afterContext: 5
+         *     batch: false
+         *     beforeContext: 5
+         *     bulk: false
+         *     busyTimeout: 5000
+         *     commitEvery: 0
+         *     commitSeconds: 0
          *     config: Config::CONFIG_FILE
+         *     connect: empty string
+         *     createFullText: false
+         *     createSubstring: false
          *     database: Config::DATABASE_FILE
          *     directories: current directory('.')
+         *     filesWithMatches: false
+         *     fullText: false
+         *     fuzzy: 0
          *     help: false
          *     index: false
+         *     journalMode: empty string
+         *     jobs: 1
          *     matches: Options::UNLIMITED_MATCHES
+         *     maxDocuments: 0
+         *     maxMemory: 0
+         *     mmap: false
+         *     nullSeparated: false
+         *     processes: false
          *     query: empty string
          *     recursion: Options::RECURSE_INFINITELY
+         *     regularExpression: false
+         *     serve: empty string
+         *     sort: empty string
+         *     timeout: 0
          *     update: false
          *     vacuum: false
          *     verbose: false
+         *     walker: "boost"
+         *     walAutocheckpoint: 1000
+         *     walkJobs: 1
          * </pre>
          * @note Copies argv.
          */
@@ -104,7 +197,11 @@ namespace Pdfsearch {
         getopt();
         /** Validate options.
          * Check that mutually exclusive options are not given, either index,
-         * query, update or vacuum is given and matches < UNLIMITED_MATCHES.
+         * query, batch, serve, update, vacuum or create index option is
+         * given, matches < UNLIMITED_MATCHES, jobs > 0, context, worker
+         * process, commit and database limits aren't negative, journal
+         * mode, sort and walker are known and walk-jobs > 0 and used only
+         * with the getdents walker.
          * Other kind of option validation happens when option is used.
          * @throws std::invalid_argument if there's an invalid option.
          */
@@ -120,16 +217,83 @@ namespace Pdfsearch {
         /** Print help. */
         static void
         printHelp();
+        /** After context option getter.
+         * @return Number of words after a match in query context.
+         */
+        int
+        getAfterContext() const { return afterContext; };
+        /** Batch option getter.
+         * @return True if queries are read from standard input.
+         */
+        bool
+        getBatch() const { return batch; };
+        /** Before context option getter.
+         * @return Number of words before a match in query context.
+         */
+        int
+        getBeforeContext() const { return beforeContext; };
+        /** Bulk option getter.
+         * @return True if bulk option was given as argument, false otherwise.
+         */
+        bool
+        getBulk() const { return bulk; };
+        /** Busy timeout option getter.
+         * @return Milliseconds to wait for a locked database.
+         */
+        int
+        getBusyTimeout() const { return busyTimeout; };
+        /** Commit every option getter.
+         * @return Number of pdfs to commit at once, 0 for all.
+         */
+        int
+        getCommitEvery() const { return commitEvery; };
+        /** Commit seconds option getter.
+         * @return Seconds between commits, 0 for no limit.
+         */
+        int
+        getCommitSeconds() const { return commitSeconds; };
         /** %Config file option getter.
          * @return A path to config file.
          */
         std::string
         getConfig() const { return config; };
+        /** Connect option getter.
+         * @return A path to the socket of a server, or an empty string to
+         * query the database directly.
+         */
+        std::string
+        getConnect() const { return connect; };
+        /** Create full-text option getter.
+         * @return True if the full-text index should be created.
+         */
+        bool
+        getCreateFullText() const { return createFullText; };
+        /** Create substring index option getter.
+         * @return True if the substring index should be created.
+         */
+        bool
+        getCreateSubstring() const { return createSubstring; };
         /** %Database file option getter.
          * @return A path to database file.
          */
         std::string
         getDatabase() const { return database; };
+        /** Files with matches option getter.
+         * @return True if every matching pdf is printed once.
+         */
+        bool
+        getFilesWithMatches() const { return filesWithMatches; };
+        /** Full-text option getter.
+         * @return True if queries use the full-text index.
+         */
+        bool
+        getFullText() const { return fullText; };
+        /** Fuzzy option getter.
+         * @return Edit distance of terms found for a word of a full-text
+         * query, 0 for only the word.
+         */
+        int
+        getFuzzy() const { return fuzzy; };
         /** Help option getter.
          * @return True if help option was given as argument, false otherwise.
          */
@@ -145,11 +309,52 @@ namespace Pdfsearch {
          */
         bool
         getIndex() const { return index; };
+        /** Journal mode option getter.
+         * @return "delete", "wal" or an empty string for the current mode.
+         */
+        std::string
+        getJournalMode() const { return journalMode; };
+        /** Jobs option getter.
+         * @return Number of text extraction threads when indexing, or of
+         * queries answered at a time.
+         */
+        int
+        getJobs() const { return jobs; };
         /** Mathes option getter.
          * @return Options::UNLIMITED_MATCHES to return all matches.
          */
         int
         getMatches() const { return matches; };
+        /** Max documents option getter.
+         * @return Number of pdfs after which a worker process is restarted,
+         * 0 for never.
+         */
+        int
+        getMaxDocuments() const { return maxDocuments; };
+        /** Max memory option getter.
+         * @return Megabytes of memory growth after which a worker process is
+         * restarted, 0 for never.
+         */
+        int
+        getMaxMemory() const { return maxMemory; };
+        /** Mmap option getter.
+         * @return True if pdfs are mapped to memory when indexing, false if
+         * read.
+         */
+        bool
+        getMmap() const { return mmap; };
+        /** Null option getter.
+         * @return True if queries read in batch are separated by NUL, false
+         * if by newline.
+         */
+        bool
+        getNullSeparated() const { return nullSeparated; };
+        /** Processes option getter.
+         * @return True if text is extracted in worker processes, false
+         * otherwise.
+         */
+        bool
+        getProcesses() const { return processes; };
         /** Query option getter.
          * @return
          */
@@ -160,6 +365,29 @@ namespace Pdfsearch {
          */
         int
         getRecursion() const { return recursion; };
+        /** Regular expression option getter.
+         * @return True if the query is a regular expression.
+         */
+        bool
+        getRegularExpression() const { return regularExpression; };
+        /** Serve option getter.
+         * @return A path to the socket to serve queries on, or an empty
+         * string.
+         */
+        std::string
+        getServe() const { return serve; };
+        /** Sort option getter.
+         * @return "relevance", "path", "mtime" or an empty string for
+         * unsorted results.
+         */
+        std::string
+        getSort() const { return sort; };
+        /** Timeout option getter.
+         * @return Seconds to wait for a worker process to extract a pdf, 0
+         * for no limit.
+         */
+        int
+        getTimeout() const { return timeout; };
         /** Update option getter.
          * @return True if update option was given as argument, false otherwise.
          */
@@ -175,6 +403,21 @@ namespace Pdfsearch {
          */
         bool
         getVerbose() const { return verbose; };
+        /** WAL autocheckpoint option getter.
+         * @return WAL pages before an automatic checkpoint.
+         */
+        int
+        getWalAutocheckpoint() const { return walAutocheckpoint; };
+        /** Walker option getter.
+         * @return Name of the directory walker.
+         */
+        std::string
+        getWalker() const { return walker; };
+        /** Walk jobs option getter.
+         * @return Number of threads reading directories.
+         */
+        int
+        getWalkJobs() const { return walkJobs; };
     };
 }
 
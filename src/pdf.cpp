@@ -1,9 +1,78 @@
 #include "pdf.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+#include <climits>
 #include <poppler-page.h>
-#include <boost/regex.hpp>
+
+Pdfsearch::Pdf::Pdf(const std::string& file, bool mmap) :
+        file(file), mapping(nullptr), mappingLength(0) {
+    doc.reset(mmap ? loadMapped() : poppler::document::load_from_file(file));
+    if (doc == nullptr) {
+        /* The destructor isn't called. */
+        if (mapping)
+            ::munmap(mapping, mappingLength);
+        throw std::runtime_error("can't load file");
+    }
+}
+
+Pdfsearch::Pdf::Pdf(std::vector<char> data, const std::string& file) :
+        file(file), mapping(nullptr), mappingLength(0),
+        doc(poppler::document::load_from_data(&data)) {
+    if (doc == nullptr)
+        throw std::runtime_error("can't load file");
+}
+
+Pdfsearch::Pdf::~Pdf() {
+    /* The document reads the mapping until it's destroyed. */
+    doc.reset();
+    if (mapping)
+        ::munmap(mapping, mappingLength);
+}
+
+poppler::document*
+Pdfsearch::Pdf::loadMapped() {
+    int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1 || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    /* poppler takes the length as an int. */
+    if (st.st_size > INT_MAX) {
+        ::close(fd);
+        return poppler::document::load_from_file(file);
+    }
+
+    void* m = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED)
+        return nullptr;
+    mapping = m;
+    mappingLength = st.st_size;
+    /* Text extraction reads the objects mostly in order. MADV_WILLNEED
+     * would also read images of scanned pages, which aren't needed. */
+    ::madvise(mapping, mappingLength, MADV_SEQUENTIAL);
+
+    return poppler::document::load_from_raw_data(
+        static_cast<const char*>(mapping), mappingLength);
+}
 
 std::unique_ptr<std::string>
 Pdfsearch::Pdf::getPage(int i) const {
+    std::unique_ptr<std::string> text(new std::string());
+    getPage(i, *text);
+
+    return text;
+}
+
+void
+Pdfsearch::Pdf::getPage(int i, std::string& out) const {
     if (i < 0 || i >= numberOfPages())
         throw std::invalid_argument("invalid page number");
 
@@ -11,14 +80,18 @@ Pdfsearch::Pdf::getPage(int i) const {
     if (!page)
         throw std::runtime_error("can't create page");
 
-    std::vector<char> chars(page->text().to_utf8());
-
-    return std::unique_ptr<std::string>(
-        new std::string(chars.begin(), chars.end()));
+    /* poppler converts the text to UTF-8 only into a new byte_array, it's
+     * the one copy made. */
+    const poppler::byte_array chars(page->text().to_utf8());
+    out.assign(chars.data(), chars.size());
 }
 
 bool
-Pdfsearch::Pdf::filenameEndsToPdf(const std::string& file) {
-    static const boost::regex re("\\.pdf$", boost::regex::icase);
-    return boost::regex_search(file, re);
+Pdfsearch::Pdf::filenameEndsToPdf(const char* file, size_t length) {
+    static const char extension[] = ".pdf";
+    const size_t extensionLength = sizeof(extension) - 1;
+
+    return length >= extensionLength &&
+        ::strncasecmp(file + length - extensionLength, extension,
+            extensionLength) == 0;
 }
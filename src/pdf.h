@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <string>
 #include <memory>
+#include <vector>
 #include <poppler-document.h>
 
 namespace Pdfsearch {
@@ -18,17 +19,37 @@ namespace Pdfsearch {
     class Pdf {
     private:
         std::string file;
+        /* Mapping of the file, the document reads it until destroyed. */
+        void* mapping;
+        size_t mappingLength;
         std::unique_ptr<poppler::document> doc;
+
+        // Load the document from a read-only mapping of the file.
+        poppler::document*
+        loadMapped();
     public:
         /** Constructor.
+         * A mapped file isn't read with system calls, and its pages are
+         * read ahead and can be dropped from the page cache soon after
+         * they are read. The file must not be truncated while the Pdf
+         * exists, reading a truncated mapping crashes with SIGBUS.
          * @param file Pdf filename.
+         * @param mmap Map the file to memory instead of reading it.
          * @throws std::runtime_error if can't load pdf.
          */
-        Pdf(const std::string& file) :
-                file(file), doc(poppler::document::load_from_file(file)) {
-            if (doc == nullptr)
-                throw std::runtime_error("can't load file");
-        }
+        explicit Pdf(const std::string& file, bool mmap = false);
+
+        /** Load a pdf from memory, e.g. received from another process.
+         * @param data Contents of a pdf, taken by the document.
+         * @param file Name of the pdf, returned by getFile().
+         * @throws std::runtime_error if can't load pdf.
+         */
+        Pdf(std::vector<char> data, const std::string& file);
+
+        /** Destructor.
+         * Unmaps the file if it was mapped.
+         */
+        ~Pdf();
 
         /** No copying. */
         Pdf(const Pdf& other) = delete;
@@ -50,6 +71,16 @@ namespace Pdfsearch {
         std::unique_ptr<std::string>
         getPage(int page) const;
 
+        /** Get page text into a buffer.
+         * The buffer can be reused for every page, its memory is kept.
+         * @param page Page number, [0, numberOfPages()[.
+         * @param out Text of the page, replaces the content.
+         * @throws std::invalid_argument if invalid page parameter given or
+         * std::runtime_error if can't create a page.
+         */
+        void
+        getPage(int page, std::string& out) const;
+
         /** Get number of pages in a pdf.
          * @return Number of pages.
          */
@@ -68,11 +99,20 @@ namespace Pdfsearch {
 
         /** Check whether filename ends to '.pdf' case-insensitively.
          * @param file Filename.
-         * @throws std::runtime_error if regex takes too much resources (very
-         * unlikely, in practice this can be ignored).
+         * @return True if filename ends to '.pdf', false otherwise.
+         */
+        static bool
+        filenameEndsToPdf(const std::string& file) {
+            return filenameEndsToPdf(file.c_str(), file.size());
+        }
+
+        /** Check whether filename ends to '.pdf' case-insensitively.
+         * @param file Filename.
+         * @param length Length of the filename.
+         * @return True if filename ends to '.pdf', false otherwise.
          */
         static bool
-        filenameEndsToPdf(const std::string& file);
+        filenameEndsToPdf(const char* file, size_t length);
     };
 }
 
@@ -0,0 +1,156 @@
+#include "queryparser.h"
+#include <stdexcept>
+
+static bool
+isSpace(char c);
+
+static std::string
+quote(const std::string& text);
+
+Pdfsearch::QueryParser::QueryParser(const std::string& query,
+        const expand_function& expand) :
+    position(0),
+    expand(expand) {
+    const size_t size = query.size();
+    for (size_t i = 0; i < size;) {
+        const char c = query[i];
+        if (isSpace(c))
+            i++;
+        else if (c == '(' || c == ')') {
+            tokens.push_back({ c == '(' ? Token::OPEN : Token::CLOSE, "" });
+            i++;
+        }
+        else if (c == '"') {
+            const size_t end = query.find('"', i + 1);
+            if (end == std::string::npos)
+                throw std::invalid_argument("missing '\"' in query");
+            tokens.push_back({ Token::PHRASE,
+                query.substr(i + 1, end - i - 1) });
+            i = end + 1;
+        }
+        else {
+            size_t end = i;
+            while (end < size && !isSpace(query[end]) && query[end] != '(' &&
+                    query[end] != ')' && query[end] != '"') {
+                end++;
+            }
+            const std::string word(query.substr(i, end - i));
+            if (word == "AND")
+                tokens.push_back({ Token::AND, word });
+            else if (word == "OR")
+                tokens.push_back({ Token::OR, word });
+            else if (word == "NOT")
+                tokens.push_back({ Token::NOT, word });
+            else
+                tokens.push_back({ Token::WORD, word });
+            i = end;
+        }
+    }
+}
+
+std::string
+Pdfsearch::QueryParser::toMatch(const std::string& query,
+        const expand_function& expand) {
+    QueryParser parser(query, expand);
+    if (parser.tokens.empty())
+        return "";
+
+    const std::string match(parser.parseOr());
+    if (parser.position < parser.tokens.size())
+        throw std::invalid_argument("unexpected ')' in query");
+
+    return match;
+}
+
+std::string
+Pdfsearch::QueryParser::parseOr() {
+    std::string match(parseAnd());
+    while (next(Token::OR)) {
+        position++;
+        match += " OR " + parseAnd();
+    }
+
+    return match;
+}
+
+/* AND can be left out between terms. */
+std::string
+Pdfsearch::QueryParser::parseAnd() {
+    std::string match(parseNot());
+    for (;;) {
+        if (next(Token::AND))
+            position++;
+        else if (!next(Token::WORD) && !next(Token::PHRASE) &&
+                !next(Token::OPEN)) {
+            break;
+        }
+        match += " AND " + parseNot();
+    }
+
+    return match;
+}
+
+std::string
+Pdfsearch::QueryParser::parseNot() {
+    std::string match(parseTerm());
+    while (next(Token::NOT)) {
+        position++;
+        match += " NOT " + parseTerm();
+    }
+
+    return match;
+}
+
+std::string
+Pdfsearch::QueryParser::parseTerm() {
+    if (position == tokens.size())
+        throw std::invalid_argument("query ends without a term");
+
+    const Token& token = tokens[position++];
+    switch (token.type) {
+        case Token::WORD: {
+            const std::vector<std::string> terms(expand ?
+                expand(token.text) : std::vector<std::string>());
+            if (terms.empty())
+                return quote(token.text);
+            else if (terms.size() == 1)
+                return quote(terms[0]);
+
+            std::string match;
+            for (const auto& term : terms)
+                match += (match.empty() ? "(" : " OR ") + quote(term);
+            return match + ")";
+        }
+        case Token::PHRASE:
+            return quote(token.text);
+        case Token::OPEN: {
+            const std::string match(parseOr());
+            if (!next(Token::CLOSE))
+                throw std::invalid_argument("missing ')' in query");
+            position++;
+            return "(" + match + ")";
+        }
+        case Token::CLOSE:
+            throw std::invalid_argument("unexpected ')' in query");
+        default:
+            throw std::invalid_argument("unexpected '" + token.text +
+                "' in query");
+    }
+}
+
+bool
+Pdfsearch::QueryParser::next(Token::Type type) const {
+    return position < tokens.size() && tokens[position].type == type;
+}
+
+static bool
+isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+        c == '\r';
+}
+
+/* Words and phrases don't have '"', which would have to be doubled. */
+static std::string
+quote(const std::string& text) {
+    return "\"" + text + "\"";
+}
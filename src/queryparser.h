@@ -0,0 +1,72 @@
+#ifndef QUERYPARSER_H
+    #define QUERYPARSER_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Pdfsearch {
+    /** A class to translate a boolean query to an FTS5 MATCH expression.
+     * A query has words, "phrases" and groups in parentheses, combined with
+     * the operators AND, OR and NOT in upper case. Terms next to each other
+     * are combined with AND. NOT binds tightest and OR loosest, so
+     * @code kernel AND (scheduler OR cfs) NOT rt @endcode
+     * finds pages having kernel, scheduler or cfs, and not rt. Every word
+     * and phrase is quoted in the expression, so other FTS5 syntax in the
+     * query is plain text.
+     */
+    class QueryParser {
+    public:
+        /** Expands a word of a query to the terms it matches. */
+        typedef std::function<std::vector<std::string>(const std::string&)>
+            expand_function;
+    private:
+        struct Token {
+            enum Type { WORD, PHRASE, AND, OR, NOT, OPEN, CLOSE };
+            Type type;
+            std::string text;
+        };
+
+        std::vector<Token> tokens;
+        size_t position;
+        const expand_function& expand;
+
+        // Split a query to tokens.
+        // @throws std::invalid_argument if a phrase isn't closed.
+        QueryParser(const std::string& query, const expand_function& expand);
+
+        // Parse a part of the query with operators of the same precedence,
+        // from the loosest to the tightest.
+        std::string
+        parseOr();
+
+        std::string
+        parseAnd();
+
+        std::string
+        parseNot();
+
+        // Parse a word, a phrase or a group.
+        std::string
+        parseTerm();
+
+        bool
+        next(Token::Type type) const;
+    public:
+        /** Translate a query.
+         * @param query A boolean query.
+         * @param expand If set, every word is replaced with the terms it
+         * returns combined with OR, or kept if it returns no terms. Phrases
+         * are kept.
+         * @return An FTS5 MATCH expression, an empty string if the query has
+         * no terms.
+         * @throws std::invalid_argument if the query is invalid.
+         */
+        static std::string
+        toMatch(const std::string& query,
+            const expand_function& expand = nullptr);
+    };
+}
+
+#endif // QUERYPARSER_H
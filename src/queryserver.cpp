@@ -0,0 +1,571 @@
+#include "queryserver.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+/* A request is its length and the settings and the query. A reply is zero or
+ * more result frames, at most one error frame and a done frame. Numbers are
+ * in the byte order of the host, strings are a length and the data. */
+static const char RESULT_FRAME = 'R';
+static const char ERROR_FRAME = 'E';
+static const char DONE_FRAME = 'D';
+
+static const uint8_t VERBOSE = 1;
+static const uint8_t FULL_TEXT = 2;
+static const uint8_t REGEX = 4;
+static const uint8_t FILES_WITH_MATCHES = 8;
+
+/* A client sending a longer request is disconnected. */
+static const uint32_t MAX_REQUEST = 1 << 20;
+/* Results of a reply are sent when this many bytes are buffered. */
+static const size_t REPLY_BUFFER = 1 << 16;
+/* A client which doesn't send the rest of its request or doesn't read its
+ * reply for this long is disconnected. */
+static const std::chrono::seconds CLIENT_TIMEOUT(10);
+/* Bigger than any database, SQLite limits the mapping to its compile time
+ * maximum. */
+static const long long MMAP_SIZE = 1LL << 40;
+
+static void
+appendInt(std::string& s, int32_t i);
+
+static void
+appendString(std::string& s, const std::string& data);
+
+static bool
+takeInt(const std::string& s, size_t& position, int32_t& i);
+
+static bool
+takeString(const std::string& s, size_t& position, std::string& data);
+
+static void
+writeAll(int fd, const std::string& data);
+
+static sockaddr_un
+socketAddress(const std::string& path);
+
+Pdfsearch::QueryServer::QueryServer(const std::string& path,
+        const std::string& database, const DatabaseSettings& settings,
+        int jobs) :
+        path(path),
+        database(database),
+        settings(settings),
+        jobs(jobs),
+        listener(-1),
+        stopPipe{ -1, -1 },
+        stopFd(-1) {
+    if (this->settings.mmapSize == 0)
+        this->settings.mmapSize = MMAP_SIZE;
+    const sockaddr_un address(socketAddress(path));
+    const sockaddr* addr = reinterpret_cast<const sockaddr*>(&address);
+
+    auto fail = [this](int error, const char* what) {
+        if (listener != -1)
+            ::close(listener);
+        ::close(stopPipe[0]);
+        ::close(stopPipe[1]);
+        throw std::system_error(error, std::generic_category(), what);
+    };
+
+    if (::pipe(stopPipe) == -1)
+        throw std::system_error(errno, std::generic_category(), "pipe");
+    stopFd = stopPipe[1];
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1)
+        fail(errno, "socket");
+    if (::bind(listener, addr, sizeof(address)) == -1) {
+        if (errno != EADDRINUSE)
+            fail(errno, "bind");
+
+        /* Nobody accepts on a socket left by a crashed server. */
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe == -1)
+            fail(errno, "socket");
+        int result = ::connect(probe, addr, sizeof(address));
+        int error = errno;
+        ::close(probe);
+        if (result == 0 || error != ECONNREFUSED)
+            fail(EADDRINUSE, path.c_str());
+        /* connect() to a file which isn't a socket is refused too, it's
+         * left alone. */
+        struct stat st;
+        if (::lstat(path.c_str(), &st) == -1 || !S_ISSOCK(st.st_mode))
+            fail(EADDRINUSE, path.c_str());
+        if (::unlink(path.c_str()) == -1 ||
+                ::bind(listener, addr, sizeof(address)) == -1) {
+            fail(errno, "bind");
+        }
+    }
+    /* Jobs poll the socket and the ones which don't get the client mustn't
+     * block in accept(). */
+    if (::listen(listener, SOMAXCONN) == -1 ||
+            ::fcntl(listener, F_SETFL, O_NONBLOCK) == -1) {
+        int error = errno;
+        ::unlink(path.c_str());
+        fail(error, "listen");
+    }
+}
+
+Pdfsearch::QueryServer::~QueryServer() {
+    stop();
+    ::close(stopPipe[0]);
+    ::close(listener);
+    ::unlink(path.c_str());
+}
+
+void
+Pdfsearch::QueryServer::run() {
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto job = [&]() {
+        try {
+            serve();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+            stop();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (int i = 0; i < jobs; i++)
+            threads.emplace_back(job);
+    }
+    catch (...) {
+        stop();
+        for (auto& t : threads)
+            t.join();
+        throw;
+    }
+    for (auto& t : threads)
+        t.join();
+
+    for (int client : idleClients)
+        ::close(client);
+    idleClients.clear();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void
+Pdfsearch::QueryServer::stop() {
+    /* Every job polls the read end, which is at end of file when the write
+     * end is closed. */
+    int fd = stopFd.exchange(-1);
+    if (fd != -1)
+        ::close(fd);
+}
+
+void
+Pdfsearch::QueryServer::serve() {
+    Database db(database, settings);
+    std::vector<struct pollfd> fds;
+    for (;;) {
+        /* A job which returned a client polls it, the others may poll an
+         * older set. */
+        fds.clear();
+        fds.push_back({ stopPipe[0], POLLIN, 0 });
+        fds.push_back({ listener, POLLIN, 0 });
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            for (int client : idleClients)
+                fds.push_back({ client, POLLIN, 0 });
+        }
+        if (::poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (fds[0].revents)
+            return;
+        /* The new client is polled right away, ready ones stay ready. */
+        if (fds[1].revents) {
+            accept();
+            continue;
+        }
+
+        /* Another job may have taken a ready client already. The client is
+         * put back last, so clients take turns. */
+        int client = -1;
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            for (size_t i = 2; i < fds.size() && client == -1; i++) {
+                if (!fds[i].revents)
+                    continue;
+                auto it = std::find(idleClients.begin(), idleClients.end(),
+                    fds[i].fd);
+                if (it != idleClients.end()) {
+                    client = *it;
+                    idleClients.erase(it);
+                }
+            }
+        }
+        if (client == -1)
+            continue;
+
+        /* A client which disconnects in the middle of a reply or sends an
+         * invalid request is dropped. */
+        bool connected = false;
+        try {
+            connected = serveRequest(db, client);
+        }
+        catch (const std::exception&) {
+        }
+        if (connected) {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            idleClients.push_back(client);
+        }
+        else
+            ::close(client);
+    }
+}
+
+void
+Pdfsearch::QueryServer::accept() {
+    int client = ::accept(listener, nullptr, nullptr);
+    if (client == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+                errno == ECONNABORTED) {
+            return;
+        }
+        throw std::system_error(errno, std::generic_category(), "accept");
+    }
+
+    int flags = ::fcntl(client, F_GETFL);
+    if (flags == -1 || ::fcntl(client, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+        ::close(client);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    idleClients.push_back(client);
+}
+
+bool
+Pdfsearch::QueryServer::serveRequest(const Database& db, int client) {
+    /* The client has started sending, a slow one is dropped. */
+    const auto deadline = Clock::now() + CLIENT_TIMEOUT;
+    uint32_t length;
+    if (!receive(client, &length, sizeof(length), deadline))
+        return false;
+    if (length > MAX_REQUEST)
+        throw std::runtime_error("request too long");
+    std::string request(length, '\0');
+    if (!receive(client, &request[0], length, deadline))
+        return false;
+
+    QuerySettings querySettings;
+    int32_t matches, fuzzy, wordsBefore, wordsAfter;
+    uint8_t flags;
+    size_t position = 0;
+    if (!takeInt(request, position, matches) ||
+            !takeInt(request, position, fuzzy) ||
+            !takeInt(request, position, wordsBefore) ||
+            !takeInt(request, position, wordsAfter) ||
+            position == request.size()) {
+        throw std::runtime_error("invalid request");
+    }
+    flags = request[position++];
+    if (!takeString(request, position, querySettings.sort))
+        throw std::runtime_error("invalid request");
+    querySettings.matches = matches;
+    querySettings.fuzzy = fuzzy;
+    querySettings.wordsBefore = wordsBefore;
+    querySettings.wordsAfter = wordsAfter;
+    querySettings.verbose = flags & VERBOSE;
+    querySettings.fullText = flags & FULL_TEXT;
+    querySettings.regex = flags & REGEX;
+    querySettings.filesWithMatches = flags & FILES_WITH_MATCHES;
+    const std::string query(request, position);
+
+    std::string reply;
+    try {
+        db.query(query, querySettings, [&](const QueryResult& r) {
+            reply += RESULT_FRAME;
+            appendInt(reply, r.page);
+            appendInt(reply, r.pages);
+            appendString(reply, r.file);
+            appendString(reply, r.chunk);
+            if (reply.size() >= REPLY_BUFFER) {
+                send(client, reply);
+                reply.clear();
+            }
+        });
+    }
+    catch (const std::system_error&) {
+        throw;
+    }
+    catch (const std::exception& e) {
+        reply += ERROR_FRAME;
+        appendString(reply, e.what());
+    }
+    reply += DONE_FRAME;
+    send(client, reply);
+
+    return true;
+}
+
+bool
+Pdfsearch::QueryServer::receive(int client, void* buffer, size_t size,
+        Clock::time_point deadline) {
+    char* p = static_cast<char*>(buffer);
+    while (size > 0) {
+        if (!wait(client, POLLIN, deadline))
+            return false;
+
+        ssize_t n = ::read(client, p, size);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        else if (n == 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+void
+Pdfsearch::QueryServer::send(int client, const std::string& data) {
+    const char* p = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        if (!wait(client, POLLOUT, Clock::now() + CLIENT_TIMEOUT))
+            throw std::system_error(ETIMEDOUT, std::generic_category(), "send");
+
+        /* Writable means some room, a blocking send would wait for room
+         * for all of the data. */
+        ssize_t n = ::send(client, p, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n == -1) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+bool
+Pdfsearch::QueryServer::wait(int client, short events,
+        Clock::time_point deadline) {
+    for (;;) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - Clock::now()).count();
+        if (left <= 0)
+            return false;
+
+        struct pollfd fds[] = {
+            { client, events, 0 },
+            { stopPipe[0], POLLIN, 0 }
+        };
+        int ready = ::poll(fds, 2, left);
+        if (ready == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+        if (fds[1].revents)
+            return false;
+        /* Errors and hang ups are reported by the read or send. */
+        if (ready > 0)
+            return true;
+    }
+}
+
+Pdfsearch::QueryClient::QueryClient(const std::string& path) :
+        socket(-1),
+        buffer(REPLY_BUFFER),
+        begin(0),
+        end(0) {
+    const sockaddr_un address(socketAddress(path));
+    socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket == -1)
+        throw std::system_error(errno, std::generic_category(), "socket");
+    if (::connect(socket, reinterpret_cast<const sockaddr*>(&address),
+            sizeof(address)) == -1) {
+        int error = errno;
+        ::close(socket);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+}
+
+Pdfsearch::QueryClient::~QueryClient() {
+    ::close(socket);
+}
+
+void
+Pdfsearch::QueryClient::query(const std::string& query,
+        const QuerySettings& settings, const Database::result_callback& found) {
+    std::string request;
+    appendInt(request, settings.matches);
+    appendInt(request, settings.fuzzy);
+    appendInt(request, settings.wordsBefore);
+    appendInt(request, settings.wordsAfter);
+    request += static_cast<char>((settings.verbose ? VERBOSE : 0) |
+        (settings.fullText ? FULL_TEXT : 0) | (settings.regex ? REGEX : 0) |
+        (settings.filesWithMatches ? FILES_WITH_MATCHES : 0));
+    appendString(request, settings.sort);
+    request += query;
+    if (request.size() > MAX_REQUEST)
+        throw std::invalid_argument("query too long");
+
+    std::string message;
+    appendString(message, request);
+    writeAll(socket, message);
+
+    std::string error;
+    /* After a partly read reply, the next reply can't be found. */
+    try {
+        for (;;) {
+            char type;
+            receive(&type, sizeof(type));
+            if (type == RESULT_FRAME) {
+                int32_t page, pages;
+                receive(&page, sizeof(page));
+                receive(&pages, sizeof(pages));
+                QueryResult r;
+                r.page = page;
+                r.pages = pages;
+                r.file = receiveString();
+                r.chunk = receiveString();
+                found(r);
+            }
+            else if (type == ERROR_FRAME)
+                error = receiveString();
+            else if (type == DONE_FRAME)
+                break;
+            else
+                throw std::runtime_error("invalid reply from server");
+        }
+    }
+    catch (...) {
+        ::shutdown(socket, SHUT_RDWR);
+        throw;
+    }
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+void
+Pdfsearch::QueryClient::receive(void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        if (begin == end) {
+            ssize_t n = ::read(socket, buffer.data(), buffer.size());
+            if (n == -1) {
+                if (errno == EINTR)
+                    continue;
+                throw std::system_error(errno, std::generic_category(), "read");
+            }
+            else if (n == 0)
+                throw std::runtime_error("server closed the connection");
+            begin = 0;
+            end = n;
+        }
+
+        size_t n = std::min(size, end - begin);
+        std::memcpy(p, buffer.data() + begin, n);
+        begin += n;
+        p += n;
+        size -= n;
+    }
+}
+
+std::string
+Pdfsearch::QueryClient::receiveString() {
+    uint32_t length;
+    receive(&length, sizeof(length));
+    std::string s(length, '\0');
+    receive(&s[0], length);
+
+    return s;
+}
+
+static void
+appendInt(std::string& s, int32_t i) {
+    s.append(reinterpret_cast<const char*>(&i), sizeof(i));
+}
+
+static void
+appendString(std::string& s, const std::string& data) {
+    uint32_t length = data.size();
+    s.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    s += data;
+}
+
+/* Return false if s is too short. */
+static bool
+takeInt(const std::string& s, size_t& position, int32_t& i) {
+    if (s.size() - position < sizeof(i))
+        return false;
+    std::memcpy(&i, s.data() + position, sizeof(i));
+    position += sizeof(i);
+
+    return true;
+}
+
+static bool
+takeString(const std::string& s, size_t& position, std::string& data) {
+    uint32_t length;
+    if (s.size() - position < sizeof(length))
+        return false;
+    std::memcpy(&length, s.data() + position, sizeof(length));
+    position += sizeof(length);
+    if (s.size() - position < length)
+        return false;
+    data.assign(s, position, length);
+    position += length;
+
+    return true;
+}
+
+static void
+writeAll(int fd, const std::string& data) {
+    const char* p = data.data();
+    size_t size = data.size();
+    while (size > 0) {
+        ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+static sockaddr_un
+socketAddress(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty())
+        throw std::system_error(EINVAL, std::generic_category(), "socket");
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::system_error(ENAMETOOLONG, std::generic_category(), path);
+    std::memcpy(address.sun_path, path.data(), path.size());
+
+    return address;
+}
@@ -0,0 +1,181 @@
+#ifndef QUERYSERVER_H
+    #define QUERYSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "database.h"
+
+namespace Pdfsearch {
+    /** A server answering queries on a Unix domain socket.
+     * Every job thread has its own connection to the database, which keeps
+     * its prepared statements and cache between queries. Connected clients
+     * wait in a poll set shared by the jobs, and a job answers one query of
+     * a client at a time, so an idle client doesn't keep a job. The
+     * database file is memory mapped, so the connections share its pages. A
+     * client sends queries and reads the results with QueryClient.
+     * Example usage:
+     * @code
+       Pdfsearch::QueryServer server("/run/pdfsearch.sock", file, settings,
+           jobs);
+       // stop() from another thread or a signal handler.
+       server.run();
+       @endcode
+     * @note The class is non-copyable.
+     */
+    class QueryServer {
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        std::string path;
+        std::string database;
+        DatabaseSettings settings;
+        int jobs;
+        /* Listening socket. */
+        int listener;
+        /* Both ends of a pipe, the write end is closed to stop every job. */
+        int stopPipe[2];
+        std::atomic<int> stopFd;
+        /* Connected clients waiting for their next query, no job is
+         * reading them. */
+        std::vector<int> idleClients;
+        std::mutex clientsMutex;
+
+        // Loop of a job thread, accepts clients and answers their queries
+        // until stopped.
+        void
+        serve();
+
+        // Accept a client and add it to the idle clients.
+        void
+        accept();
+
+        // Answer one query of a client, false if the client disconnected.
+        bool
+        serveRequest(const Database& db, int client);
+
+        // Read a number of bytes from a client, false on end of file, stop
+        // or when the deadline passes.
+        bool
+        receive(int client, void* buffer, size_t size,
+            Clock::time_point deadline);
+
+        // Write data to a client, throws if the client doesn't read it in
+        // time or on stop.
+        void
+        send(int client, const std::string& data);
+
+        // Wait for poll events of a client, false on stop or when the
+        // deadline passes.
+        bool
+        wait(int client, short events, Clock::time_point deadline);
+    public:
+        /** Create the socket and start listening to it.
+         * A socket file left by a server which is no longer running is
+         * replaced.
+         * @param path Filename of the socket.
+         * @param database Database file, must exist.
+         * @param settings Settings of the connections to the database. The
+         * whole file is mapped if DatabaseSettings::mmapSize is 0.
+         * @param jobs Number of clients served at a time, > 0.
+         * @throws std::system_error if the socket can't be created or
+         * another server is listening to it.
+         */
+        QueryServer(const std::string& path, const std::string& database,
+            const DatabaseSettings& settings, int jobs);
+
+        /** Non-copyable. */
+        QueryServer(const QueryServer& other) = delete;
+        /** Non-copyable. */
+        QueryServer& operator=(const QueryServer& other) = delete;
+        /** Non-copyable. */
+        QueryServer(QueryServer&& other) = delete;
+        /** Non-copyable. */
+        QueryServer& operator=(QueryServer&& other) = delete;
+
+        /** Destructor.
+         * Closes and removes the socket.
+         */
+        ~QueryServer();
+
+        /** Serve clients until stop() is called. Clients still connected
+         * are disconnected.
+         * @throws DatabaseError if a job can't open the database.
+         * @throws std::system_error if accepting clients fails.
+         */
+        void
+        run();
+
+        /** Stop serving. run() returns after the queries being answered
+         * are done, a client being sent a reply is disconnected. Safe to
+         * call from a signal handler.
+         */
+        void
+        stop();
+    };
+
+    /** A connection to a QueryServer.
+     * Example usage:
+     * @code
+       Pdfsearch::QueryClient client("/run/pdfsearch.sock");
+       client.query("pdf", settings, [](const Pdfsearch::QueryResult& r) {
+           // Use r.
+       });
+       @endcode
+     * @note The class is non-copyable.
+     */
+    class QueryClient {
+    private:
+        int socket;
+        /* Received bytes from begin to end haven't been read yet. */
+        std::vector<char> buffer;
+        size_t begin;
+        size_t end;
+
+        // Read a number of bytes from the server.
+        void
+        receive(void* data, size_t size);
+
+        // Read a length and that many bytes from the server.
+        std::string
+        receiveString();
+    public:
+        /** Connect to a server.
+         * @param path Filename of the socket of the server.
+         * @throws std::system_error if can't connect.
+         */
+        explicit QueryClient(const std::string& path);
+
+        /** Non-copyable. */
+        QueryClient(const QueryClient& other) = delete;
+        /** Non-copyable. */
+        QueryClient& operator=(const QueryClient& other) = delete;
+        /** Non-copyable. */
+        QueryClient(QueryClient&& other) = delete;
+        /** Non-copyable. */
+        QueryClient& operator=(QueryClient&& other) = delete;
+
+        /** Destructor.
+         * Closes the connection.
+         */
+        ~QueryClient();
+
+        /** Query the database of the server, see Database#query(
+         * const std::string&, const QuerySettings&,
+         * const Database::result_callback&) const.
+         * @param query Query string.
+         * @param settings Settings for the query.
+         * @param found Called with every result as it's received.
+         * @throws std::runtime_error if the query fails on the server, or
+         * if the server closes the connection.
+         * @throws std::system_error on socket errors.
+         */
+        void
+        query(const std::string& query, const QuerySettings& settings,
+            const Database::result_callback& found);
+    };
+}
+
+#endif // QUERYSERVER_H
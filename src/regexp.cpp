@@ -0,0 +1,1081 @@
+#include "regexp.h"
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <unicode/uchar.h>
+#include "casefolder.h"
+
+/* Largest count of a repetition and number of instructions in a program. */
+static const int MAX_REPEAT = 1000;
+static const size_t MAX_PROGRAM = 100000;
+
+/* Largest set of strings a part of an expression is known to match
+ * exactly. Bigger sets aren't worth a lookup of every string. */
+static const size_t MAX_EXACT = 16;
+
+/* Strings shorter than a trigram can't be looked up. */
+static const size_t TRIGRAM_LENGTH = 3;
+
+/* Decoded in place of an invalid UTF-8 sequence. */
+static const char32_t INVALID_CHARACTER = 0xFFFD;
+
+/* A character class is a list of ranges of characters and of \d, \w and \s
+ * classes. */
+struct ClassItem {
+    char32_t first;
+    char32_t last;
+    /* 'd', 'w' or 's' for a \d, \w or \s class, 0 for a range. */
+    char shorthand;
+    bool negated;
+};
+
+struct CharacterClass {
+    std::vector<ClassItem> items;
+    bool negated;
+
+    bool
+    contains(char32_t c) const;
+
+    bool
+    strings(std::set<std::string>& strings) const;
+};
+
+enum Assertion { LINE_BEGIN, LINE_END, WORD_BOUNDARY, NOT_WORD_BOUNDARY };
+
+/* An instruction of the Pike VM. SPLIT continues at x and y, x first,
+ * JUMP at x, CLASS matches classes[x] and ASSERT checks assertion x. */
+struct Instruction {
+    enum Op { CHARACTER, ANY, CLASS, SPLIT, JUMP, ASSERT, MATCH };
+    Op op;
+    char32_t character;
+    int x;
+    int y;
+};
+
+/* A thread of the Pike VM, at an instruction and with the start of its
+ * match. */
+struct Thread {
+    int pc;
+    size_t start;
+};
+
+/* Pages which may match: every page, or pages having all or any of subs,
+ * or pages having a string. */
+struct TrigramQuery {
+    enum Type { ALL, AND, OR, STRING };
+    Type type;
+    std::vector<TrigramQuery> subs;
+    std::string string;
+};
+
+/* What a part of an expression matches: exactly one of strings, or
+ * something on a page matching the query. */
+struct MatchInfo {
+    bool exact;
+    std::set<std::string> strings;
+    TrigramQuery query;
+};
+
+struct Pdfsearch::Regexp::Node {
+    enum Type { EMPTY, CHARACTER, ANY, CLASS, CONCAT, ALTERNATE, REPEAT,
+        ASSERT };
+    Type type;
+    char32_t character;
+    CharacterClass characterClass;
+    std::vector<Node> children;
+    /* Repetition counts, max is -1 for no limit. */
+    int min;
+    int max;
+    bool greedy;
+    Assertion assertion;
+
+    explicit Node(Type type) :
+        type(type), character(0), characterClass(), min(0), max(0),
+        greedy(true), assertion(LINE_BEGIN) {
+    };
+
+    MatchInfo
+    analyze() const;
+};
+
+struct Pdfsearch::Regexp::Parser {
+    const std::string& pattern;
+    size_t position;
+
+    explicit Parser(const std::string& pattern) :
+        pattern(pattern), position(0) {
+    };
+
+    Node
+    parseAlternation();
+
+    Node
+    parseConcat();
+
+    Node
+    parseRepeat();
+
+    Node
+    parseAtom();
+
+    Node
+    parseClass();
+
+    bool
+    parseCount(int& min, int& max);
+
+    bool
+    parseClassCharacter(ClassItem& item);
+
+    bool
+    accept(char c);
+
+    static Node
+    literal(char32_t c);
+};
+
+struct Pdfsearch::Regexp::Program {
+    std::vector<Instruction> instructions;
+    std::vector<CharacterClass> classes;
+
+    void
+    compile(const Node& node);
+
+    int
+    emit(Instruction::Op op, char32_t character = 0, int x = 0, int y = 0);
+
+    void
+    addThread(std::vector<Thread>& threads, std::vector<size_t>& marks,
+        size_t generation, std::vector<int>& stack, int pc, size_t start,
+        boost::string_view text, size_t position) const;
+
+    bool
+    consumes(const Instruction& instruction, char32_t c) const;
+};
+
+static char32_t
+decode(boost::string_view text, size_t position, size_t& length);
+
+static char32_t
+decodeBefore(boost::string_view text, size_t position);
+
+static std::string
+encode(char32_t c);
+
+static char32_t
+foldAscii(char32_t c);
+
+static bool
+isWordCharacter(char32_t c);
+
+static bool
+holds(Assertion assertion, boost::string_view text, size_t position);
+
+static TrigramQuery
+allPages();
+
+static TrigramQuery
+both(const TrigramQuery& a, const TrigramQuery& b);
+
+static TrigramQuery
+either(const TrigramQuery& a, const TrigramQuery& b);
+
+static TrigramQuery
+anyString(const std::set<std::string>& strings);
+
+static TrigramQuery
+required(const MatchInfo& info);
+
+static std::string
+toMatch(const TrigramQuery& query, bool nested);
+
+static bool
+concatenate(const std::set<std::string>& a, const std::set<std::string>& b,
+    std::set<std::string>& result);
+
+Pdfsearch::Regexp::Regexp(const std::string& pattern) {
+    Parser parser(pattern);
+    const Node root(parser.parseAlternation());
+    if (parser.position < pattern.size())
+        throw std::invalid_argument("unexpected ')' in regex");
+
+    std::shared_ptr<Program> p(new Program);
+    p->compile(root);
+    p->emit(Instruction::MATCH);
+    program = p;
+
+    trigramQuery = toMatch(required(root.analyze()), false);
+}
+
+/* Threads are kept in the order of their priority. A thread for a match
+ * starting at a position is added after the threads already running, and
+ * when a thread matches, the threads after it are dropped. */
+bool
+Pdfsearch::Regexp::match(boost::string_view text, size_t from, size_t& begin,
+        size_t& end) const {
+    const size_t size = text.size();
+    std::vector<Thread> current, next;
+    std::vector<size_t> marks(program->instructions.size(), 0);
+    std::vector<int> stack;
+    size_t generation = 1;
+    bool matched = false;
+
+    for (size_t position = from; ; ) {
+        if (!matched) {
+            program->addThread(current, marks, generation, stack, 0, position,
+                text, position);
+        }
+        if (current.empty() && (matched || position == size))
+            break;
+
+        size_t length = 0;
+        const char32_t c = position < size ?
+            decode(text, position, length) : 0;
+        for (const Thread& thread : current) {
+            const Instruction& instruction =
+                program->instructions[thread.pc];
+            if (instruction.op == Instruction::MATCH) {
+                matched = true;
+                begin = thread.start;
+                end = position;
+                break;
+            }
+            if (position < size && program->consumes(instruction, c)) {
+                program->addThread(next, marks, generation + 1, stack,
+                    thread.pc + 1, thread.start, text, position + length);
+            }
+        }
+        if (position == size)
+            break;
+
+        current.swap(next);
+        next.clear();
+        generation++;
+        position += length;
+    }
+
+    return matched;
+}
+
+int
+Pdfsearch::Regexp::count(boost::string_view text) const {
+    int matches = 0;
+    size_t begin, end = 0;
+    while (match(text, end, begin, end)) {
+        matches++;
+        /* An empty match would be found again at the same position. */
+        if (end == begin)
+            break;
+    }
+
+    return matches;
+}
+
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::parseAlternation() {
+    Node first(parseConcat());
+    if (position == pattern.size() || pattern[position] != '|')
+        return first;
+
+    Node alternation(Node::ALTERNATE);
+    alternation.children.push_back(std::move(first));
+    while (accept('|'))
+        alternation.children.push_back(parseConcat());
+
+    return alternation;
+}
+
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::parseConcat() {
+    Node concat(Node::CONCAT);
+    while (position < pattern.size() && pattern[position] != '|' &&
+            pattern[position] != ')') {
+        concat.children.push_back(parseRepeat());
+    }
+
+    if (concat.children.empty())
+        return Node(Node::EMPTY);
+    else if (concat.children.size() == 1)
+        return std::move(concat.children[0]);
+
+    return concat;
+}
+
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::parseRepeat() {
+    Node atom(parseAtom());
+    for (;;) {
+        int min, max;
+        if (accept('*')) {
+            min = 0;
+            max = -1;
+        }
+        else if (accept('+')) {
+            min = 1;
+            max = -1;
+        }
+        else if (accept('?')) {
+            min = 0;
+            max = 1;
+        }
+        else if (!parseCount(min, max))
+            break;
+
+        if (atom.type == Node::ASSERT)
+            throw std::invalid_argument("nothing to repeat in regex");
+
+        Node repeat(Node::REPEAT);
+        repeat.min = min;
+        repeat.max = max;
+        repeat.greedy = !accept('?');
+        repeat.children.push_back(std::move(atom));
+        atom = std::move(repeat);
+    }
+
+    return atom;
+}
+
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::parseAtom() {
+    const char c = pattern[position];
+    if (c == '(') {
+        position++;
+        if (pattern.compare(position, 2, "?:") == 0)
+            position += 2;
+        else if (position < pattern.size() && pattern[position] == '?')
+            throw std::invalid_argument("unsupported group in regex");
+
+        Node group(parseAlternation());
+        if (!accept(')'))
+            throw std::invalid_argument("missing ')' in regex");
+        return group;
+    }
+    else if (c == '*' || c == '+' || c == '?')
+        throw std::invalid_argument("nothing to repeat in regex");
+    else if (c == '[')
+        return parseClass();
+
+    position++;
+    Node node(Node::ASSERT);
+    switch (c) {
+        case '.':
+            return Node(Node::ANY);
+        case '^':
+            node.assertion = LINE_BEGIN;
+            return node;
+        case '$':
+            node.assertion = LINE_END;
+            return node;
+        case '\\':
+            break;
+        default: {
+            size_t length;
+            const char32_t character = decode(pattern, position - 1, length);
+            position += length - 1;
+            return literal(character);
+        }
+    }
+
+    if (position == pattern.size())
+        throw std::invalid_argument("trailing '\\' in regex");
+
+    const char e = pattern[position];
+    if (e == 'b' || e == 'B') {
+        position++;
+        node.assertion = e == 'b' ? WORD_BOUNDARY : NOT_WORD_BOUNDARY;
+        return node;
+    }
+
+    /* Every other escape is the same in and outside a class. */
+    position--;
+    ClassItem item;
+    parseClassCharacter(item);
+    if (item.shorthand == 0)
+        return literal(item.first);
+
+    Node characterClass(Node::CLASS);
+    characterClass.characterClass.negated = false;
+    characterClass.characterClass.items.push_back(item);
+
+    return characterClass;
+}
+
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::parseClass() {
+    position++;
+    Node node(Node::CLASS);
+    CharacterClass& characterClass = node.characterClass;
+    characterClass.negated = accept('^');
+
+    /* A ']' first in a class is the character. */
+    for (bool first = true; ; first = false) {
+        if (position == pattern.size())
+            throw std::invalid_argument("missing ']' in regex");
+        if (!first && accept(']'))
+            break;
+
+        ClassItem item;
+        parseClassCharacter(item);
+        if (item.shorthand == 0 && position + 1 < pattern.size() &&
+                pattern[position] == '-' && pattern[position + 1] != ']') {
+            position++;
+            ClassItem last;
+            parseClassCharacter(last);
+            if (last.shorthand != 0 || last.first < item.first)
+                throw std::invalid_argument("invalid range in regex");
+            item.last = last.first;
+        }
+        characterClass.items.push_back(item);
+
+        /* A character is also matched by its folded character. */
+        if (item.shorthand == 0 && item.first == item.last &&
+                item.first >= 0x80) {
+            const Node folded(literal(item.first));
+            if (folded.type == Node::CHARACTER &&
+                    folded.character != item.first) {
+                characterClass.items.push_back(
+                    { folded.character, folded.character, 0, false });
+            }
+        }
+    }
+
+    return node;
+}
+
+/* {n}, {n,} or {n,m}. Anything else is not a count, the '{' is a
+ * character. */
+bool
+Pdfsearch::Regexp::Parser::parseCount(int& min, int& max) {
+    auto number = [this](size_t& i, int& n) {
+        const size_t start = i;
+        n = 0;
+        for (; i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9';
+                i++) {
+            if (n <= MAX_REPEAT)
+                n = 10 * n + (pattern[i] - '0');
+        }
+        return i > start;
+    };
+
+    size_t i = position;
+    if (i == pattern.size() || pattern[i] != '{' || !number(++i, min))
+        return false;
+
+    if (i < pattern.size() && pattern[i] == '}')
+        max = min;
+    else if (i < pattern.size() && pattern[i] == ',') {
+        i++;
+        if (i < pattern.size() && pattern[i] == '}')
+            max = -1;
+        else if (!number(i, max) || i == pattern.size() || pattern[i] != '}')
+            return false;
+    }
+    else
+        return false;
+
+    if (min > MAX_REPEAT || max > MAX_REPEAT)
+        throw std::invalid_argument("repetition count is too big in regex");
+    if (max != -1 && max < min)
+        throw std::invalid_argument("invalid repetition count in regex");
+    position = i + 1;
+
+    return true;
+}
+
+/* A character, an escaped character or a \d, \w or \s class. */
+bool
+Pdfsearch::Regexp::Parser::parseClassCharacter(ClassItem& item) {
+    item.shorthand = 0;
+    item.negated = false;
+
+    size_t length;
+    char32_t c = decode(pattern, position, length);
+    position += length;
+    if (c == '\\') {
+        if (position == pattern.size())
+            throw std::invalid_argument("trailing '\\' in regex");
+
+        c = decode(pattern, position, length);
+        position += length;
+        switch (c) {
+            case 'd': case 'w': case 's':
+            case 'D': case 'W': case 'S':
+                item.shorthand = foldAscii(c);
+                item.negated = c < 'a';
+                break;
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'f': c = '\f'; break;
+            case 'v': c = '\v'; break;
+            default:
+                if (c < 0x80 && (u_isalnum(c) || c == '_')) {
+                    throw std::invalid_argument("invalid escape '\\" +
+                        encode(c) + "' in regex");
+                }
+        }
+    }
+    item.first = item.last = c;
+
+    return true;
+}
+
+bool
+Pdfsearch::Regexp::Parser::accept(char c) {
+    if (position < pattern.size() && pattern[position] == c) {
+        position++;
+        return true;
+    }
+
+    return false;
+}
+
+/* A character is folded like the text of a page. It may fold to several
+ * characters or to none. */
+Pdfsearch::Regexp::Node
+Pdfsearch::Regexp::Parser::literal(char32_t c) {
+    std::vector<char32_t> folded;
+    if (c < 0x80)
+        folded.push_back(foldAscii(c));
+    else {
+        const std::string s(Pdfsearch::CaseFolder::fold(encode(c)));
+        for (size_t i = 0, length; i < s.size(); i += length)
+            folded.push_back(decode(s, i, length));
+    }
+
+    Node concat(Node::CONCAT);
+    for (char32_t f : folded) {
+        Node character(Node::CHARACTER);
+        character.character = f;
+        concat.children.push_back(std::move(character));
+    }
+
+    if (concat.children.empty())
+        return Node(Node::EMPTY);
+    else if (concat.children.size() == 1)
+        return std::move(concat.children[0]);
+
+    return concat;
+}
+
+void
+Pdfsearch::Regexp::Program::compile(const Node& node) {
+    switch (node.type) {
+        case Node::EMPTY:
+            break;
+        case Node::CHARACTER:
+            emit(Instruction::CHARACTER, node.character);
+            break;
+        case Node::ANY:
+            emit(Instruction::ANY);
+            break;
+        case Node::CLASS:
+            classes.push_back(node.characterClass);
+            emit(Instruction::CLASS, 0, classes.size() - 1);
+            break;
+        case Node::ASSERT:
+            emit(Instruction::ASSERT, 0, node.assertion);
+            break;
+        case Node::CONCAT:
+            for (const auto& child : node.children)
+                compile(child);
+            break;
+        case Node::ALTERNATE: {
+            std::vector<int> jumps;
+            for (size_t i = 0; i + 1 < node.children.size(); i++) {
+                const int split = emit(Instruction::SPLIT);
+                instructions[split].x = split + 1;
+                compile(node.children[i]);
+                jumps.push_back(emit(Instruction::JUMP));
+                instructions[split].y = instructions.size();
+            }
+            compile(node.children.back());
+            for (int jump : jumps)
+                instructions[jump].x = instructions.size();
+            break;
+        }
+        case Node::REPEAT: {
+            const Node& child = node.children[0];
+            /* x+ is compiled as x followed by a loop back to it. */
+            const int copies = node.max == -1 && node.min > 0 ?
+                node.min - 1 : node.min;
+            for (int i = 0; i < copies; i++)
+                compile(child);
+
+            if (node.max == -1) {
+                if (node.min > 0) {
+                    const int loop = instructions.size();
+                    compile(child);
+                    const int split = emit(Instruction::SPLIT, 0, loop,
+                        instructions.size() + 1);
+                    if (!node.greedy)
+                        std::swap(instructions[split].x, instructions[split].y);
+                }
+                else {
+                    const int split = emit(Instruction::SPLIT);
+                    compile(child);
+                    emit(Instruction::JUMP, 0, split);
+                    instructions[split].x = split + 1;
+                    instructions[split].y = instructions.size();
+                    if (!node.greedy)
+                        std::swap(instructions[split].x, instructions[split].y);
+                }
+                break;
+            }
+
+            std::vector<int> splits;
+            for (int i = node.min; i < node.max; i++) {
+                splits.push_back(emit(Instruction::SPLIT));
+                compile(child);
+            }
+            for (int split : splits) {
+                instructions[split].x = split + 1;
+                instructions[split].y = instructions.size();
+                if (!node.greedy)
+                    std::swap(instructions[split].x, instructions[split].y);
+            }
+            break;
+        }
+    }
+}
+
+int
+Pdfsearch::Regexp::Program::emit(Instruction::Op op, char32_t character,
+        int x, int y) {
+    if (instructions.size() >= MAX_PROGRAM)
+        throw std::invalid_argument("regex is too big");
+    instructions.push_back({ op, character, x, y });
+
+    return instructions.size() - 1;
+}
+
+/* Follows jumps, splits and assertions to the instructions which consume a
+ * character or match, in the order of their priority. An instruction is
+ * added once per position, marked with the generation of the list. */
+void
+Pdfsearch::Regexp::Program::addThread(std::vector<Thread>& threads,
+        std::vector<size_t>& marks, size_t generation,
+        std::vector<int>& stack, int pc, size_t start,
+        boost::string_view text, size_t position) const {
+    stack.push_back(pc);
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        if (marks[pc] == generation)
+            continue;
+        marks[pc] = generation;
+
+        const Instruction& instruction = instructions[pc];
+        switch (instruction.op) {
+            case Instruction::JUMP:
+                stack.push_back(instruction.x);
+                break;
+            case Instruction::SPLIT:
+                stack.push_back(instruction.y);
+                stack.push_back(instruction.x);
+                break;
+            case Instruction::ASSERT:
+                if (holds(static_cast<Assertion>(instruction.x), text,
+                        position)) {
+                    stack.push_back(pc + 1);
+                }
+                break;
+            default:
+                threads.push_back({ pc, start });
+        }
+    }
+}
+
+bool
+Pdfsearch::Regexp::Program::consumes(const Instruction& instruction,
+        char32_t c) const {
+    switch (instruction.op) {
+        case Instruction::CHARACTER:
+            return foldAscii(c) == instruction.character;
+        case Instruction::ANY:
+            return c != '\n';
+        case Instruction::CLASS:
+            return classes[instruction.x].contains(c);
+        default:
+            return false;
+    }
+}
+
+/* The folded text has a character in one case, so it's in a class if one of
+ * its case mappings is, like ä in [À-Ö]. */
+bool
+CharacterClass::contains(char32_t c) const {
+    char32_t cases[] = { c, c, c };
+    if (c < 0x80)
+        cases[1] = c >= 'a' && c <= 'z' ? c - 0x20 : foldAscii(c);
+    else {
+        cases[1] = u_toupper(c);
+        cases[2] = u_totitle(c);
+        if (cases[1] == c && cases[2] == c)
+            cases[1] = cases[2] = u_tolower(c);
+    }
+    bool found = false;
+    for (const auto& item : items) {
+        if (item.shorthand != 0) {
+            bool in;
+            if (item.shorthand == 'd')
+                in = u_isdigit(c);
+            else if (item.shorthand == 'w')
+                in = u_isalnum(c) || c == '_';
+            else
+                in = u_isUWhiteSpace(c);
+            found = in != item.negated;
+        }
+        else {
+            for (char32_t k : cases)
+                found = found || (k >= item.first && k <= item.last);
+        }
+        if (found)
+            break;
+    }
+
+    return found != negated;
+}
+
+/* The characters of a small class as they can be in the folded text, see
+ * contains(). */
+bool
+CharacterClass::strings(std::set<std::string>& strings) const {
+    if (negated)
+        return false;
+
+    for (const auto& item : items) {
+        if (item.shorthand != 0 || item.last - item.first >= MAX_EXACT)
+            return false;
+        for (char32_t c = item.first; c <= item.last; c++) {
+            if (c < 0x80)
+                strings.insert(encode(foldAscii(c)));
+            else {
+                strings.insert(encode(c));
+                strings.insert(encode(u_tolower(c)));
+                strings.insert(encode(u_toupper(c)));
+            }
+            if (strings.size() > MAX_EXACT)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* A concatenation is exact while the cross product of its parts is small.
+ * When it gets too big, the strings so far are required and a new product
+ * is started. */
+MatchInfo
+Pdfsearch::Regexp::Node::analyze() const {
+    MatchInfo info;
+    info.exact = true;
+    info.query = allPages();
+
+    switch (type) {
+        case EMPTY:
+        case ASSERT:
+            info.strings.insert("");
+            break;
+        case CHARACTER:
+            info.strings.insert(encode(character));
+            break;
+        case ANY:
+            info.exact = false;
+            break;
+        case CLASS:
+            info.exact = characterClass.strings(info.strings);
+            if (!info.exact)
+                info.strings.clear();
+            break;
+        case CONCAT: {
+            info.strings.insert("");
+            for (const auto& child : children) {
+                const MatchInfo c(child.analyze());
+                std::set<std::string> product;
+                if (c.exact && concatenate(info.strings, c.strings, product))
+                    info.strings.swap(product);
+                else if (c.exact) {
+                    info.query = both(info.query, anyString(info.strings));
+                    info.strings = c.strings;
+                    info.exact = false;
+                }
+                else {
+                    info.query = both(both(info.query,
+                        anyString(info.strings)), c.query);
+                    info.strings = { "" };
+                    info.exact = false;
+                }
+            }
+            if (!info.exact) {
+                info.query = both(info.query, anyString(info.strings));
+                info.strings.clear();
+            }
+            break;
+        }
+        case ALTERNATE: {
+            TrigramQuery query;
+            for (size_t i = 0; i < children.size(); i++) {
+                const MatchInfo c(children[i].analyze());
+                query = i == 0 ? required(c) : either(query, required(c));
+                if (info.exact && c.exact) {
+                    info.strings.insert(c.strings.begin(), c.strings.end());
+                    info.exact = info.strings.size() <= MAX_EXACT;
+                }
+                else
+                    info.exact = false;
+            }
+            if (!info.exact) {
+                info.strings.clear();
+                info.query = query;
+            }
+            break;
+        }
+        case REPEAT: {
+            const MatchInfo c(children[0].analyze());
+            info.exact = false;
+            if (min == 0 && max == 1 && c.exact) {
+                info.exact = true;
+                info.strings = c.strings;
+                info.strings.insert("");
+            }
+            else if (min > 0 && min == max && c.exact) {
+                info.exact = true;
+                info.strings = { "" };
+                for (int i = 0; i < min && info.exact; i++) {
+                    std::set<std::string> product;
+                    info.exact = concatenate(info.strings, c.strings,
+                        product);
+                    info.strings.swap(product);
+                }
+                if (!info.exact)
+                    info.strings.clear();
+            }
+            if (!info.exact && min > 0)
+                info.query = required(c);
+            break;
+        }
+    }
+
+    return info;
+}
+
+/* Invalid bytes are one character each. */
+static char32_t
+decode(boost::string_view text, size_t position, size_t& length) {
+    const unsigned char first = text[position];
+    if (first < 0x80) {
+        length = 1;
+        return first;
+    }
+
+    int continuation;
+    char32_t c;
+    if ((first & 0xE0) == 0xC0) {
+        continuation = 1;
+        c = first & 0x1F;
+    }
+    else if ((first & 0xF0) == 0xE0) {
+        continuation = 2;
+        c = first & 0x0F;
+    }
+    else if ((first & 0xF8) == 0xF0) {
+        continuation = 3;
+        c = first & 0x07;
+    }
+    else {
+        length = 1;
+        return INVALID_CHARACTER;
+    }
+
+    if (position + continuation >= text.size()) {
+        length = 1;
+        return INVALID_CHARACTER;
+    }
+    for (int i = 1; i <= continuation; i++) {
+        const unsigned char byte = text[position + i];
+        if ((byte & 0xC0) != 0x80) {
+            length = 1;
+            return INVALID_CHARACTER;
+        }
+        c = (c << 6) | (byte & 0x3F);
+    }
+    length = continuation + 1;
+
+    return c;
+}
+
+static char32_t
+decodeBefore(boost::string_view text, size_t position) {
+    size_t start = position - 1;
+    while (start > 0 && position - start < 4 &&
+            (text[start] & 0xC0) == 0x80) {
+        start--;
+    }
+
+    size_t length;
+    const char32_t c = decode(text, start, length);
+
+    return start + length == position ? c : INVALID_CHARACTER;
+}
+
+static std::string
+encode(char32_t c) {
+    std::string s;
+    if (c < 0x80)
+        s += static_cast<char>(c);
+    else if (c < 0x800) {
+        s += static_cast<char>(0xC0 | (c >> 6));
+        s += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+        s += static_cast<char>(0xE0 | (c >> 12));
+        s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else {
+        s += static_cast<char>(0xF0 | (c >> 18));
+        s += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        s += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        s += static_cast<char>(0x80 | (c & 0x3F));
+    }
+
+    return s;
+}
+
+static char32_t
+foldAscii(char32_t c) {
+    return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
+}
+
+static bool
+isWordCharacter(char32_t c) {
+    return u_isalnum(c) || c == '_';
+}
+
+static bool
+holds(Assertion assertion, boost::string_view text, size_t position) {
+    const size_t size = text.size();
+    switch (assertion) {
+        case LINE_BEGIN:
+            return position == 0 || text[position - 1] == '\n';
+        case LINE_END:
+            return position == size || text[position] == '\n';
+        default: {
+            size_t length;
+            const bool before = position > 0 &&
+                isWordCharacter(decodeBefore(text, position));
+            const bool after = position < size &&
+                isWordCharacter(decode(text, position, length));
+            return (before != after) == (assertion == WORD_BOUNDARY);
+        }
+    }
+}
+
+static TrigramQuery
+allPages() {
+    return { TrigramQuery::ALL, {}, "" };
+}
+
+static TrigramQuery
+both(const TrigramQuery& a, const TrigramQuery& b) {
+    if (a.type == TrigramQuery::ALL)
+        return b;
+    else if (b.type == TrigramQuery::ALL)
+        return a;
+
+    TrigramQuery query{ TrigramQuery::AND, {}, "" };
+    for (const auto* q : { &a, &b }) {
+        if (q->type == TrigramQuery::AND)
+            query.subs.insert(query.subs.end(), q->subs.begin(), q->subs.end());
+        else
+            query.subs.push_back(*q);
+    }
+
+    return query;
+}
+
+static TrigramQuery
+either(const TrigramQuery& a, const TrigramQuery& b) {
+    if (a.type == TrigramQuery::ALL || b.type == TrigramQuery::ALL)
+        return allPages();
+
+    TrigramQuery query{ TrigramQuery::OR, {}, "" };
+    for (const auto* q : { &a, &b }) {
+        if (q->type == TrigramQuery::OR)
+            query.subs.insert(query.subs.end(), q->subs.begin(), q->subs.end());
+        else
+            query.subs.push_back(*q);
+    }
+
+    return query;
+}
+
+/* A string shorter than a trigram could be anywhere. */
+static TrigramQuery
+anyString(const std::set<std::string>& strings) {
+    TrigramQuery query(allPages());
+    bool first = true;
+    for (const auto& s : strings) {
+        size_t characters = 0;
+        for (char c : s) {
+            if ((c & 0xC0) != 0x80)
+                characters++;
+        }
+        if (characters < TRIGRAM_LENGTH)
+            return allPages();
+
+        const TrigramQuery string{ TrigramQuery::STRING, {}, s };
+        query = first ? string : either(query, string);
+        first = false;
+    }
+
+    return query;
+}
+
+static TrigramQuery
+required(const MatchInfo& info) {
+    return info.exact ? anyString(info.strings) : info.query;
+}
+
+/* Strings are quoted, a '"' in a string is doubled. */
+static std::string
+toMatch(const TrigramQuery& query, bool nested) {
+    switch (query.type) {
+        case TrigramQuery::ALL:
+            return "";
+        case TrigramQuery::STRING: {
+            std::string quoted("\"");
+            for (char c : query.string) {
+                if (c == '"')
+                    quoted += '"';
+                quoted += c;
+            }
+            return quoted + '"';
+        }
+        default: {
+            std::string match;
+            for (const auto& sub : query.subs) {
+                if (!match.empty())
+                    match += query.type == TrigramQuery::AND ? " AND " : " OR ";
+                match += toMatch(sub, true);
+            }
+            return nested ? "(" + match + ")" : match;
+        }
+    }
+}
+
+static bool
+concatenate(const std::set<std::string>& a, const std::set<std::string>& b,
+        std::set<std::string>& result) {
+    if (a.size() * b.size() > MAX_EXACT)
+        return false;
+
+    for (const auto& x : a) {
+        for (const auto& y : b)
+            result.insert(x + y);
+    }
+
+    return true;
+}
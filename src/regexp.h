@@ -0,0 +1,89 @@
+#ifndef REGEXP_H
+    #define REGEXP_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+namespace Pdfsearch {
+    /** A class to search text with a regular expression in linear time.
+     * The expression is compiled to an NFA which is simulated on the text
+     * (a Pike VM), so a search takes O(text length * expression length)
+     * time whatever the expression, and there are no backreferences.
+     * The syntax:
+     *  - Characters match themselves, ASCII letters case-insensitively.
+     *    Other characters are folded like CaseFolder folds them, so the
+     *    expression matches the folded text of a page.
+     *  - '.' matches any character but a line break, [abc], [a-z] and
+     *    [^abc] a character of a class. \\d, \\w and \\s match a digit, a
+     *    word character and whitespace, \\D, \\W and \\S anything else,
+     *    also in a class.
+     *  - '^' and '$' match at the beginning and at the end of a line, \\b
+     *    at a word boundary and \\B elsewhere.
+     *  - '|' is an alternation, (...) and (?:...) a group.
+     *  - '*', '+', '?', {n}, {n,} and {n,m} repeat, followed by '?' as few
+     *    times as possible.
+     *  - \\n, \\t, \\r, \\f and \\v are control characters, '\\' followed by
+     *    another punctuation character is the character.
+     *
+     * A search finds the leftmost match, and of the matches starting there
+     * the one a backtracking engine would find.
+     * Example usage:
+     * @code
+       Pdfsearch::Regexp regexp("CVE-20[0-9]{2}-[0-9]+");
+       size_t begin, end;
+       if (regexp.match(text, 0, begin, end))
+           // ...
+       @endcode
+     */
+    class Regexp {
+    private:
+        struct Node;
+        struct Parser;
+        struct Program;
+
+        std::shared_ptr<const Program> program;
+        std::string trigramQuery;
+    public:
+        /** Compile a regular expression.
+         * @param pattern The expression in UTF-8.
+         * @throws std::invalid_argument if the expression is invalid or too
+         * big.
+         */
+        explicit Regexp(const std::string& pattern);
+
+        /** Find the first match starting at or after from.
+         * @param text UTF-8 text to search.
+         * @param from Byte offset where to start, at a character boundary.
+         * The text before it is seen by '^' and \\b.
+         * @param begin Set to the start of the match.
+         * @param end Set to the end of the match.
+         * @return True if the expression matches, false otherwise.
+         */
+        bool
+        match(boost::string_view text, size_t from, size_t& begin,
+            size_t& end) const;
+
+        /** Count the matches.
+         * Matches don't overlap, an expression matching an empty string
+         * matches once.
+         * @param text UTF-8 text to search.
+         * @return Number of matches.
+         */
+        int
+        count(boost::string_view text) const;
+
+        /** Get the strings every match needs.
+         * Every text the expression matches has the strings combined with
+         * AND and OR, like Russ Cox's code search finds them, so a trigram
+         * index can find the candidate texts.
+         * @return An FTS5 MATCH expression for a trigram index, an empty
+         * string if no string is needed.
+         */
+        const std::string&
+        getTrigramQuery() const { return trigramQuery; };
+    };
+}
+
+#endif // REGEXP_H
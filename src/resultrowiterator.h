@@ -4,6 +4,9 @@
 #include <sqlite3.h>
 #include <stdexcept>
 #include <memory>
+#include <string>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
 #include "database_error.h"
 
 namespace Pdfsearch {
@@ -142,6 +145,52 @@ namespace Pdfsearch {
         template<typename T> std::unique_ptr<T>
         column(int column);
 
+        /** Get value of a column in resultset without allocating.
+         * Valid generic types are int, sqlite3_int64, double and
+         * boost::string_view, which points to the text in SQLite's buffer
+         * and is valid until the next row or reset of the statement.
+         * Example:
+         * @code
+         * boost::optional<int> pages(it.value<int>(0));
+         * boost::optional<boost::string_view> text(
+         *     it.value<boost::string_view>(1));
+         * @endcode
+         * @param column Column index. 0 <= column < number of columns.
+         * @return Value of a column in resultset, boost::none if the
+         * database column is NULL.
+         * @throws DatabaseError if there is no row ready or if index is < 0 or
+         * >= number of columns in resultset or if generic type is not the
+         * same as column's type.
+         */
+        template<typename T> boost::optional<T>
+        value(int column);
+
+        /** Get the bytes of a blob column in resultset without allocating.
+         * @param column Column index. 0 <= column < number of columns.
+         * @return The bytes in SQLite's buffer, valid until the next row or
+         * reset of the statement, boost::none if the database column is
+         * NULL.
+         * @throws DatabaseError if there is no row ready or if index is < 0 or
+         * >= number of columns in resultset or if the column is not a blob.
+         */
+        boost::optional<boost::string_view>
+        blob(int column) {
+            validateCol(column);
+
+            int type = sqlite3_column_type(statement.get(), column);
+            if (type == SQLITE_NULL)
+                return boost::none;
+            else if (type != SQLITE_BLOB)
+                throw DatabaseError("column's type is not blob");
+
+            /* Bytes are asked after the pointer, a zero length blob has a
+             * null pointer. */
+            const char* data = static_cast<const char*>(
+                sqlite3_column_blob(statement.get(), column));
+            return boost::string_view(data ? data : "",
+                sqlite3_column_bytes(statement.get(), column));
+        };
+
         /** Get current row number.
          * @return Current row number.
          */
@@ -159,61 +208,73 @@ namespace Pdfsearch {
         };
     };
 
-    template<> inline std::unique_ptr<int>
-    ResultRowIterator::column<int>(int column) {
+    template<> inline boost::optional<int>
+    ResultRowIterator::value<int>(int column) {
         validateCol(column);
 
         int type = sqlite3_column_type(statement.get(), column);
         if (type == SQLITE_NULL)
-            return std::unique_ptr<int>(nullptr);
+            return boost::none;
         else if (type != SQLITE_INTEGER)
             throw DatabaseError("column's type is not int");
 
-        return std::unique_ptr<int>(
-            new int(sqlite3_column_int(statement.get(), column)));
+        return sqlite3_column_int(statement.get(), column);
     }
 
-    template<> inline std::unique_ptr<sqlite3_int64>
-    ResultRowIterator::column<sqlite3_int64>(int column) {
+    template<> inline boost::optional<sqlite3_int64>
+    ResultRowIterator::value<sqlite3_int64>(int column) {
         validateCol(column);
 
         int type = sqlite3_column_type(statement.get(), column);
         if (type == SQLITE_NULL)
-            return std::unique_ptr<sqlite3_int64>(nullptr);
+            return boost::none;
         else if (type != SQLITE_INTEGER)
             throw DatabaseError("column's type is not int");
 
-        return std::unique_ptr<sqlite3_int64>(
-            new sqlite3_int64(sqlite3_column_int(statement.get(), column)));
+        return sqlite3_column_int64(statement.get(), column);
     }
 
-    template<> inline std::unique_ptr<double>
-    ResultRowIterator::column<double>(int column) {
+    template<> inline boost::optional<double>
+    ResultRowIterator::value<double>(int column) {
         validateCol(column);
 
         int type = sqlite3_column_type(statement.get(), column);
         if (type == SQLITE_NULL)
-            return std::unique_ptr<double>(nullptr);
+            return boost::none;
         else if (type != SQLITE_FLOAT)
             throw DatabaseError("column's type is not double");
 
-        return std::unique_ptr<double>(
-            new double(sqlite3_column_double(statement.get(), column)));
+        return sqlite3_column_double(statement.get(), column);
     }
 
-    template<> inline std::unique_ptr<std::string>
-    ResultRowIterator::column<std::string>(int column) {
+    template<> inline boost::optional<boost::string_view>
+    ResultRowIterator::value<boost::string_view>(int column) {
         validateCol(column);
 
         int type = sqlite3_column_type(statement.get(), column);
         if (type == SQLITE_NULL)
-            return std::unique_ptr<std::string>(nullptr);
+            return boost::none;
         else if (type != SQLITE_TEXT)
             throw DatabaseError("column's type is not std::string");
 
-        return std::unique_ptr<std::string>(new std::string(
-            reinterpret_cast<const char*>(
-                sqlite3_column_text(statement.get(), column))));
+        /* Bytes are asked after the text, which may convert the value. */
+        const char* text = reinterpret_cast<const char*>(
+            sqlite3_column_text(statement.get(), column));
+        return boost::string_view(text,
+            sqlite3_column_bytes(statement.get(), column));
+    }
+
+    template<typename T> inline std::unique_ptr<T>
+    ResultRowIterator::column(int column) {
+        const auto& v(value<T>(column));
+        return std::unique_ptr<T>(v ? new T(*v) : nullptr);
+    }
+
+    template<> inline std::unique_ptr<std::string>
+    ResultRowIterator::column<std::string>(int column) {
+        const auto& v(value<boost::string_view>(column));
+        return std::unique_ptr<std::string>(
+            v ? new std::string(v->data(), v->size()) : nullptr);
     }
 }
 
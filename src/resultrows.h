@@ -0,0 +1,257 @@
+#ifndef RESULTROWS_H
+    #define RESULTROWS_H
+
+#include <sqlite3.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include "database_error.h"
+
+namespace Pdfsearch {
+    /** Decoding of a column of type T. Only the specializations exist, a
+     * row of other types doesn't compile.
+     */
+    template<typename T> struct ColumnReader;
+
+    /** An integer column read as int. */
+    template<> struct ColumnReader<int> {
+        static bool
+        accepts(int type) { return type == SQLITE_INTEGER; };
+
+        static int
+        read(sqlite3_stmt* statement, int column) {
+            return sqlite3_column_int(statement, column);
+        };
+    };
+
+    /** An integer column read as sqlite3_int64. */
+    template<> struct ColumnReader<sqlite3_int64> {
+        static bool
+        accepts(int type) { return type == SQLITE_INTEGER; };
+
+        static sqlite3_int64
+        read(sqlite3_stmt* statement, int column) {
+            return sqlite3_column_int64(statement, column);
+        };
+    };
+
+    /** A float column read as double. */
+    template<> struct ColumnReader<double> {
+        static bool
+        accepts(int type) { return type == SQLITE_FLOAT; };
+
+        static double
+        read(sqlite3_stmt* statement, int column) {
+            return sqlite3_column_double(statement, column);
+        };
+    };
+
+    /** A text column read as a view to SQLite's buffer, valid until the
+     * next row. */
+    template<> struct ColumnReader<boost::string_view> {
+        static bool
+        accepts(int type) { return type == SQLITE_TEXT; };
+
+        static boost::string_view
+        read(sqlite3_stmt* statement, int column) {
+            /* Bytes are asked after the text, which may convert the value. */
+            const char* text = reinterpret_cast<const char*>(
+                sqlite3_column_text(statement, column));
+            return boost::string_view(text ? text : "",
+                sqlite3_column_bytes(statement, column));
+        };
+    };
+
+    /** A text column copied to a string. */
+    template<> struct ColumnReader<std::string> {
+        static bool
+        accepts(int type) { return type == SQLITE_TEXT; };
+
+        static std::string
+        read(sqlite3_stmt* statement, int column) {
+            return ColumnReader<boost::string_view>::read(statement, column)
+                .to_string();
+        };
+    };
+
+    /** A nullable column, boost::none if the column is NULL. */
+    template<typename T> struct ColumnReader<boost::optional<T>> {
+        static bool
+        accepts(int type) {
+            return type == SQLITE_NULL || ColumnReader<T>::accepts(type);
+        };
+
+        static boost::optional<T>
+        read(sqlite3_stmt* statement, int column) {
+            if (sqlite3_column_type(statement, column) == SQLITE_NULL)
+                return boost::none;
+            return ColumnReader<T>::read(statement, column);
+        };
+    };
+
+    /** Column numbers of a row, 0 to N - 1. */
+    template<size_t... I> struct ColumnIndices {
+    };
+
+    /** Make ColumnIndices<0, ..., N - 1> as type. */
+    template<size_t N, size_t... I> struct MakeColumnIndices :
+        MakeColumnIndices<N - 1, N - 1, I...> {
+    };
+
+    template<size_t... I> struct MakeColumnIndices<0, I...> {
+        typedef ColumnIndices<I...> type;
+    };
+
+    /** Rows of a resultset as tuples of the column types.
+     * The number of columns is checked when the rows are created and the
+     * types of the columns on the first row, later rows are decoded
+     * without checks. A NULL column needs a boost::optional type. Valid
+     * column types are int, sqlite3_int64, double, boost::string_view,
+     * std::string and boost::optional of them. Views point to SQLite's
+     * buffers and are valid until the next row. Use
+     * Statement#rows() to create. Example usage:
+     * @code
+       sqlite3_int64 id;
+       boost::string_view file;
+       for (const auto& row : s.rows<sqlite3_int64, boost::string_view>()) {
+           std::tie(id, file) = row;
+           // ...
+       @endcode
+     */
+    template<typename... Ts> class ResultRows {
+    private:
+        std::shared_ptr<sqlite3_stmt> statement;
+        // Column numbers of a row.
+        typedef typename MakeColumnIndices<sizeof...(Ts)>::type indices;
+    public:
+        /** A row of the resultset. */
+        typedef std::tuple<Ts...> row_type;
+
+        /** An input iterator to the rows. */
+        class iterator {
+        private:
+            std::shared_ptr<sqlite3_stmt> statement;
+            // SQLITE_ROW if row is read, SQLITE_DONE after the last row.
+            int status;
+            row_type row;
+
+            // Step to the next row and decode it. Types are checked before
+            // decoding, which may convert them.
+            void
+            step(bool first) {
+                status = sqlite3_step(statement.get());
+                if (status == SQLITE_ROW) {
+                    if (first)
+                        check(indices());
+                    read(indices());
+                }
+                else if (status != SQLITE_DONE)
+                    throw DatabaseError(status, sqlite3_errstr(status));
+            };
+
+            template<size_t... I> void
+            read(ColumnIndices<I...>) {
+                row = row_type(
+                    ColumnReader<Ts>::read(statement.get(), I)...);
+            }
+
+            template<size_t... I> void
+            check(ColumnIndices<I...>) const {
+                const bool accepted[] = { ColumnReader<Ts>::accepts(
+                    sqlite3_column_type(statement.get(), I))... };
+                for (size_t i = 0; i < sizeof...(Ts); i++) {
+                    if (!accepted[i])
+                        throw DatabaseError("type of column " +
+                            std::to_string(i) + " doesn't match");
+                }
+            }
+        public:
+            /** Constructor.
+             * @param statement Prepared statement.
+             * @param begin If true, read the first row, otherwise create
+             * the end of the rows.
+             * @throws DatabaseError if step to the first row fails or if
+             * the types of its columns don't match.
+             */
+            iterator(std::shared_ptr<sqlite3_stmt> statement, bool begin) :
+                    statement(statement), status(SQLITE_DONE) {
+                if (begin)
+                    step(true);
+            };
+
+            /** Get the current row.
+             * @return The row.
+             */
+            const row_type&
+            operator*() const {
+                return row;
+            };
+
+            /** Get the next row.
+             * @return This iterator.
+             * @throws DatabaseError if step to next row fails.
+             */
+            iterator&
+            operator++() {
+                if (status == SQLITE_DONE)
+                    throw DatabaseError("out of resultset bounds");
+                step(false);
+
+                return *this;
+            };
+
+            /** Equality operator.
+             * @param rhs Other iterator of the same statement.
+             * @return True if both are at the end of the rows.
+             */
+            bool
+            operator==(const iterator& rhs) const {
+                return status == SQLITE_DONE && rhs.status == SQLITE_DONE;
+            };
+
+            /** Unequality operator.
+             * @param rhs Other iterator of the same statement.
+             * @return False if both are at the end of the rows.
+             */
+            bool
+            operator!=(const iterator& rhs) const {
+                return !operator==(rhs);
+            };
+        };
+
+        /** Constructor.
+         * @param statement Prepared statement.
+         * @throws DatabaseError if the statement doesn't have
+         * sizeof...(Ts) columns.
+         */
+        explicit ResultRows(std::shared_ptr<sqlite3_stmt> statement) :
+                statement(statement) {
+            static_assert(sizeof...(Ts) > 0, "a row needs a column");
+            if (sqlite3_column_count(statement.get()) != sizeof...(Ts))
+                throw DatabaseError("number of columns doesn't match");
+        };
+
+        /** Read the first row.
+         * @return Iterator to the first row.
+         * @throws DatabaseError if step to the first row fails or if the
+         * types of its columns don't match.
+         */
+        iterator
+        begin() const {
+            return iterator(statement, true);
+        };
+
+        /** The end of the rows.
+         * @return Iterator past the last row.
+         */
+        iterator
+        end() const {
+            return iterator(statement, false);
+        };
+    };
+}
+
+#endif // RESULTROWS_H
@@ -0,0 +1,287 @@
+#include "snippet.h"
+
+#ifdef __SSE2__
+    #include <emmintrin.h>
+#endif
+
+/* Wildcards of LIKE. */
+static const char ANY_CHARACTERS = '%';
+static const char ANY_CHARACTER = '_';
+
+static unsigned char
+fold(char c);
+
+static bool
+isLetter(unsigned char c);
+
+static bool
+isSpace(char c);
+
+static size_t
+nextCharacter(boost::string_view text, size_t i);
+
+static size_t
+previousCharacter(boost::string_view text, size_t i);
+
+static bool
+equalFolded(const char* a, const char* b, size_t length);
+
+static size_t
+findLiteral(boost::string_view text, size_t from, const char* literal,
+    size_t length);
+
+static bool
+matchAt(boost::string_view text, size_t i, const std::string& segment,
+    size_t& end);
+
+Pdfsearch::Snippet::Snippet(const std::string& query, int wordsBefore,
+        int wordsAfter) :
+    wordsBefore(wordsBefore),
+    wordsAfter(wordsAfter) {
+    size_t start = 0;
+    for (;;) {
+        size_t percent = query.find(ANY_CHARACTERS, start);
+        if (percent == std::string::npos)
+            percent = query.size();
+        if (percent > start)
+            segments.push_back(query.substr(start, percent - start));
+        if (percent == query.size())
+            break;
+        start = percent + 1;
+    }
+}
+
+bool
+Pdfsearch::Snippet::match(boost::string_view text, size_t& begin, size_t& end)
+        const {
+    return match(text, 0, begin, end);
+}
+
+/* Every segment is matched at its first position after the previous one,
+ * which finds a match whenever LIKE does, because segments have a fixed
+ * length. */
+bool
+Pdfsearch::Snippet::match(boost::string_view text, size_t from, size_t& begin,
+        size_t& end) const {
+    begin = end = from;
+    for (size_t i = 0; i < segments.size(); i++) {
+        size_t segmentEnd;
+        const size_t start = findSegment(text, from, segments[i], segmentEnd);
+        if (start == std::string::npos)
+            return false;
+
+        if (i == 0)
+            begin = start;
+        end = from = segmentEnd;
+    }
+
+    return true;
+}
+
+std::string
+Pdfsearch::Snippet::find(boost::string_view text) const {
+    size_t begin, end;
+    if (!match(text, begin, end))
+        return std::string();
+
+    return cut(text, begin, end, wordsBefore, wordsAfter);
+}
+
+std::string
+Pdfsearch::Snippet::cut(boost::string_view text, size_t begin, size_t end,
+        int wordsBefore, int wordsAfter) {
+    const size_t size = text.size();
+    while (begin > 0 && !isSpace(text[begin - 1]))
+        begin--;
+    while (end < size && !isSpace(text[end]))
+        end++;
+    for (int i = 0; i < wordsBefore && begin > 0; i++) {
+        while (begin > 0 && isSpace(text[begin - 1]))
+            begin--;
+        while (begin > 0 && !isSpace(text[begin - 1]))
+            begin--;
+    }
+    for (int i = 0; i < wordsAfter && end < size; i++) {
+        while (end < size && isSpace(text[end]))
+            end++;
+        while (end < size && !isSpace(text[end]))
+            end++;
+    }
+
+    std::string snippet;
+    snippet.reserve(end - begin);
+    bool space = false;
+    for (size_t i = begin; i < end; i++) {
+        if (isSpace(text[i]))
+            space = true;
+        else {
+            if (space && !snippet.empty())
+                snippet += ' ';
+            space = false;
+            snippet += text[i];
+        }
+    }
+
+    return snippet;
+}
+
+int
+Pdfsearch::Snippet::count(boost::string_view text) const {
+    int matches = 0;
+    size_t begin, end = 0;
+    while (match(text, end, begin, end)) {
+        matches++;
+        /* An empty match would be found again at the same position. */
+        if (end == begin)
+            break;
+    }
+
+    return matches;
+}
+
+/* The first run of bytes without '_' is searched for, the rest of the
+ * segment is compared at every candidate. */
+size_t
+Pdfsearch::Snippet::findSegment(boost::string_view text, size_t from,
+        const std::string& segment, size_t& end) {
+    const size_t lead = segment.find_first_not_of(ANY_CHARACTER);
+    if (lead == std::string::npos) {
+        for (size_t i = from; i < text.size(); i = nextCharacter(text, i)) {
+            if (matchAt(text, i, segment, end))
+                return i;
+        }
+        return std::string::npos;
+    }
+
+    size_t length = segment.find(ANY_CHARACTER, lead);
+    if (length == std::string::npos)
+        length = segment.size();
+    length -= lead;
+
+    for (size_t p = from; (p = findLiteral(text, p, segment.data() + lead,
+            length)) != std::string::npos; p++) {
+        /* Every leading '_' is one character before the run. */
+        size_t start = p;
+        size_t i = 0;
+        for (; i < lead && start > from; i++)
+            start = previousCharacter(text, start);
+
+        if (i == lead && matchAt(text, start, segment, end))
+            return start;
+    }
+
+    return std::string::npos;
+}
+
+/* SQLite's LIKE folds only ASCII letters. */
+static unsigned char
+fold(char c) {
+    const unsigned char u = c;
+    return u >= 'A' && u <= 'Z' ? u | 0x20 : u;
+}
+
+static bool
+isLetter(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool
+isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+        c == '\r';
+}
+
+static size_t
+nextCharacter(boost::string_view text, size_t i) {
+    for (i++; i < text.size() && (text[i] & 0xC0) == 0x80; i++)
+        ;
+    return i;
+}
+
+static size_t
+previousCharacter(boost::string_view text, size_t i) {
+    for (i--; i > 0 && (text[i] & 0xC0) == 0x80; i--)
+        ;
+    return i;
+}
+
+static bool
+equalFolded(const char* a, const char* b, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (fold(a[i]) != fold(b[i]))
+            return false;
+    }
+
+    return true;
+}
+
+/* With SSE2 the first and the last byte of the literal are compared at 16
+ * positions at once, and only positions where both match are compared
+ * fully. A letter is compared case-insensitively by setting its 0x20 bit,
+ * which makes an upper case letter lower case and keeps a lower case
+ * letter. */
+static size_t
+findLiteral(boost::string_view text, size_t from, const char* literal,
+        size_t length) {
+    const size_t size = text.size();
+    if (length > size || from > size - length)
+        return std::string::npos;
+
+    const char* data = text.data();
+    const size_t last = size - length;
+    const unsigned char first = fold(literal[0]);
+    size_t i = from;
+#ifdef __SSE2__
+    const unsigned char final = fold(literal[length - 1]);
+    const __m128i firstBytes = _mm_set1_epi8(first);
+    const __m128i firstCase = _mm_set1_epi8(isLetter(first) ? 0x20 : 0);
+    const __m128i finalBytes = _mm_set1_epi8(final);
+    const __m128i finalCase = _mm_set1_epi8(isLetter(final) ? 0x20 : 0);
+    const size_t middle = length > 2 ? length - 2 : 0;
+
+    for (; i + 16 <= last + 1; i += 16) {
+        const __m128i a = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i));
+        const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i + length - 1));
+        const __m128i equal = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_or_si128(a, firstCase), firstBytes),
+            _mm_cmpeq_epi8(_mm_or_si128(b, finalCase), finalBytes));
+
+        unsigned mask = _mm_movemask_epi8(equal);
+        while (mask != 0) {
+            const size_t candidate = i + __builtin_ctz(mask);
+            if (equalFolded(data + candidate + 1, literal + 1, middle))
+                return candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last; i++) {
+        if (fold(data[i]) == first &&
+                equalFolded(data + i + 1, literal + 1, length - 1)) {
+            return i;
+        }
+    }
+
+    return std::string::npos;
+}
+
+static bool
+matchAt(boost::string_view text, size_t i, const std::string& segment,
+        size_t& end) {
+    for (char c : segment) {
+        if (i >= text.size())
+            return false;
+        else if (c == ANY_CHARACTER)
+            i = nextCharacter(text, i);
+        else if (fold(text[i]) != fold(c))
+            return false;
+        else
+            i++;
+    }
+    end = i;
+
+    return true;
+}
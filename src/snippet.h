@@ -0,0 +1,93 @@
+#ifndef SNIPPET_H
+    #define SNIPPET_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+namespace Pdfsearch {
+    /** A class to cut the words around a match of a query from a page.
+     * The query is matched like SQLite's LIKE matches it: ASCII letters
+     * match case-insensitively, other characters exactly, '%' matches any
+     * characters and '_' one UTF-8 character.
+     * Example usage:
+     * @code
+       Pdfsearch::Snippet snippet(query, 5, 5);
+       for (const auto& page : pages) {
+           std::string chunk(snippet.find(page));
+           // ...
+       @endcode
+     */
+    class Snippet {
+    private:
+        /* Parts of the query between '%'s, without empty parts. */
+        std::vector<std::string> segments;
+        const int wordsBefore;
+        const int wordsAfter;
+
+        // Find the first match of the query starting at or after from.
+        bool
+        match(boost::string_view text, size_t from, size_t& begin,
+            size_t& end) const;
+
+        // Find the first match of a segment starting at or after from.
+        // @return Start of the match or std::string::npos, end is set to
+        // the end of the match.
+        static size_t
+        findSegment(boost::string_view text, size_t from,
+            const std::string& segment, size_t& end);
+    public:
+        /** Constructor.
+         * @param query The query, may contain '%' and '_' wildcards.
+         * @param wordsBefore Number of words before the match, >= 0.
+         * @param wordsAfter Number of words after the match, >= 0.
+         */
+        Snippet(const std::string& query, int wordsBefore, int wordsAfter);
+
+        /** Find the first match of the query.
+         * A query having only wildcards matches at the beginning of the
+         * text.
+         * @param text Text to search.
+         * @param begin Set to the start of the match.
+         * @param end Set to the end of the match.
+         * @return True if the query matches, false otherwise.
+         */
+        bool
+        match(boost::string_view text, size_t& begin, size_t& end) const;
+
+        /** Cut the words around the first match of the query.
+         * The words containing the match are included whole and runs of
+         * whitespace are replaced with a space.
+         * @param text Text to search.
+         * @return The match with wordsBefore words before and wordsAfter
+         * words after it, an empty string if the query doesn't match.
+         */
+        std::string
+        find(boost::string_view text) const;
+
+        /** Cut the words around a match.
+         * The words containing the match are included whole and runs of
+         * whitespace are replaced with a space.
+         * @param text Text having the match.
+         * @param begin Start of the match.
+         * @param end End of the match, >= begin.
+         * @param wordsBefore Number of words before the match, >= 0.
+         * @param wordsAfter Number of words after the match, >= 0.
+         * @return The match with the words around it.
+         */
+        static std::string
+        cut(boost::string_view text, size_t begin, size_t end,
+            int wordsBefore, int wordsAfter);
+
+        /** Count the matches of the query.
+         * Matches don't overlap, a query having only wildcards matches once.
+         * @param text Text to search.
+         * @return Number of matches.
+         */
+        int
+        count(boost::string_view text) const;
+    };
+}
+
+#endif // SNIPPET_H
@@ -1,10 +1,11 @@
 #include "statement.h"
 
 sqlite3_stmt*
-Pdfsearch::Statement::allocateStatement(sqlite3* db, const std::string& sql) {
+Pdfsearch::Statement::allocateStatement(sqlite3* db, const std::string& sql,
+        unsigned int flags) {
     sqlite3_stmt* statement;
-    int result = sqlite3_prepare_v2(db, sql.c_str(), sql.size() + 1, &statement,
-        nullptr);
+    int result = sqlite3_prepare_v3(db, sql.c_str(), sql.size() + 1, flags,
+        &statement, nullptr);
     if (result != SQLITE_OK)
         throw DatabaseError(result, sqlite3_errstr(result));
 
@@ -17,8 +18,8 @@ Pdfsearch::Statement::deleteStatement(sqlite3_stmt* statement) {
 }
 
 Pdfsearch::Statement::Statement(const Pdfsearch::Database& db,
-        const std::string& sql) :
-    statement(allocateStatement(db.db, sql), deleteStatement) {
+        const std::string& sql, unsigned int flags) :
+    statement(allocateStatement(db.db, sql, flags), deleteStatement) {
 }
 
 void
@@ -4,13 +4,22 @@
 #include <sqlite3.h>
 #include <string>
 #include <memory>
+#include <boost/utility/string_view.hpp>
 #include "database.h"
 #include "database_error.h"
 #include "resultrowiterator.h"
+#include "resultrows.h"
 
 namespace Pdfsearch {
     class Database;
 
+    /** Bytes to bind as a blob with Statement#bind(). Not copied, see
+     * binding of boost::string_view.
+     */
+    struct Blob {
+        boost::string_view bytes;
+    };
+
     /** A class to prepare an SQL statement.
      * @note The class in non-copyable.
      */
@@ -20,7 +29,8 @@ namespace Pdfsearch {
 
         // Allocator for Statement::statement.
         static sqlite3_stmt*
-        allocateStatement(sqlite3* db, const std::string& sql);
+        allocateStatement(sqlite3* db, const std::string& sql,
+            unsigned int flags);
 
         // Deleter for Statement::statement.
         static void
@@ -29,9 +39,13 @@ namespace Pdfsearch {
         /** Constractor.
          * @param db Database handle.
          * @param sql SQL command to prepare.
+         * @param flags SQLITE_PREPARE_* flags of sqlite3_prepare_v3(), e.g.
+         * SQLITE_PREPARE_PERSISTENT for a statement used for the lifetime of
+         * the connection.
          * @throws DatabaseError if fails to prepare statement.
          */
-        Statement(const Database& db, const std::string& sql);
+        Statement(const Database& db, const std::string& sql,
+            unsigned int flags = 0);
 
         /** Copy constractor deleted, always pass by reference. */
         Statement(const Statement& statement) = delete;
@@ -51,15 +65,21 @@ namespace Pdfsearch {
            stmt.bind(10, 1);             // T is int.
            stmt.bind<void*>(nullptr, 2); // void* needs template argument.
            stmt.bind(3.4, 3);            // T is double.
-           stmt.bind("bla", 4);          // T is std::string.
+           stmt.bind(std::string("bla"), 4);
+           stmt.bind(boost::string_view(text), 5); // Not copied.
+           stmt.bind(Blob{ bytes }, 6);            // Not copied.
            @endcode
          * @param value A value to bind. Can be of type an int, sqlite_int64,
-         * double, std::string or void* i.e. NULL.
+         * double, std::string, boost::string_view, Blob or void* i.e. NULL.
+         * A std::string is copied by SQLite. The bytes of a
+         * boost::string_view or a Blob aren't, they must stay valid until
+         * the parameter is bound again or the statement is stepped for the
+         * last time.
          * @param column Number of parameter to bind a value to.
          * @throws DatabaseError if can't bind value.
          */
         template<typename T>
-        void bind(T value, int column) const;
+        void bind(const T& value, int column) const;
 
         /** Get iterator to results.
          * @return ResultRowIterator
@@ -76,6 +96,21 @@ namespace Pdfsearch {
             return ResultRowIterator::end(statement);
         };
 
+        /** Get the results as typed rows.
+         * Example:
+         * @code
+           for (const auto& row : stmt.rows<int, boost::string_view>())
+               std::cout << std::get<1>(row) << std::endl;
+           @endcode
+         * @return ResultRows of the column types.
+         * @throws DatabaseError if the number of columns is not
+         * sizeof...(Ts).
+         */
+        template<typename... Ts> ResultRows<Ts...>
+        rows() const {
+            return ResultRows<Ts...>(statement);
+        }
+
         /** Evaluate the statement.
          * @throws DatabaseError if evaluating the statement fails.
          */
@@ -88,28 +123,30 @@ namespace Pdfsearch {
     };
 
     template<> inline void
-    Statement::bind<int>(int value, int column) const {
+    Statement::bind<int>(const int& value, int column) const {
         int result = sqlite3_bind_int(statement.get(), column, value);
         if (result != SQLITE_OK)
             throw DatabaseError(result, sqlite3_errstr(result));
     }
 
     template<> inline void
-    Statement::bind<sqlite3_int64>(sqlite3_int64 value, int column) const {
+    Statement::bind<sqlite3_int64>(const sqlite3_int64& value,
+            int column) const {
         int result = sqlite3_bind_int64(statement.get(), column, value);
         if (result != SQLITE_OK)
             throw DatabaseError(result, sqlite3_errstr(result));
     }
 
     template<> inline void
-    Statement::bind<double>(double value, int column) const {
+    Statement::bind<double>(const double& value, int column) const {
         int result = sqlite3_bind_double(statement.get(), column, value);
         if (result != SQLITE_OK)
             throw DatabaseError(result, sqlite3_errstr(result));
     }
 
     template<> inline void
-    Statement::bind<std::string>(std::string value, int column) const {
+    Statement::bind<std::string>(const std::string& value,
+            int column) const {
         int result = sqlite3_bind_text(statement.get(), column, value.c_str(),
             value.size(), SQLITE_TRANSIENT);
         if (result != SQLITE_OK)
@@ -117,7 +154,27 @@ namespace Pdfsearch {
     }
 
     template<> inline void
-    Statement::bind<void*>(void*, int column) const {
+    Statement::bind<boost::string_view>(const boost::string_view& value,
+            int column) const {
+        /* An empty view may not point anywhere, but is still text. */
+        int result = sqlite3_bind_text(statement.get(), column,
+            value.empty() ? "" : value.data(), value.size(), SQLITE_STATIC);
+        if (result != SQLITE_OK)
+            throw DatabaseError(result, sqlite3_errstr(result));
+    }
+
+    template<> inline void
+    Statement::bind<Blob>(const Blob& value, int column) const {
+        /* A null pointer would bind NULL. */
+        int result = sqlite3_bind_blob(statement.get(), column,
+            value.bytes.empty() ? "" : value.bytes.data(), value.bytes.size(),
+            SQLITE_STATIC);
+        if (result != SQLITE_OK)
+            throw DatabaseError(result, sqlite3_errstr(result));
+    }
+
+    template<> inline void
+    Statement::bind<void*>(void* const&, int column) const {
         int result = sqlite3_bind_null(statement.get(), column);
         if (result != SQLITE_OK)
             throw DatabaseError(result, sqlite3_errstr(result));
@@ -0,0 +1,108 @@
+#ifndef TOPK_H
+    #define TOPK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace Pdfsearch {
+    /** A heap keeping the greatest items pushed to it.
+     * Pushing n items costs O(n log k) and keeps at most k items in memory.
+     * Example usage:
+     * @code
+       Pdfsearch::TopK<int> top(2);
+       for (int i : { 3, 1, 4, 1, 5 })
+           top.push(i);
+       std::vector<int> best(top.take()); // 5, 4
+       @endcode
+     * @note The class is non-copyable.
+     */
+    template<typename T, typename Compare = std::less<T>>
+    class TopK {
+    private:
+        /* The least kept item is at the front. */
+        std::vector<T> heap;
+        const size_t capacity;
+        Compare less;
+
+        bool
+        greater(const T& a, const T& b) const {
+            return less(b, a);
+        };
+    public:
+        /** Constructor.
+         * @param capacity Number of items to keep, 0 to keep every item.
+         * @param less Ordering of the items, less(a, b) is true if a is
+         * lesser than b.
+         */
+        explicit TopK(size_t capacity, Compare less = Compare()) :
+            capacity(capacity), less(less) {
+        };
+
+        /** Non-copyable. */
+        TopK(const TopK& other) = delete;
+        /** Non-copyable. */
+        TopK& operator=(const TopK& other) = delete;
+        /** Non-copyable. */
+        TopK(TopK&& other) = delete;
+        /** Non-copyable. */
+        TopK& operator=(TopK&& other) = delete;
+
+        /** Check whether an item would be kept.
+         * Use to skip work for an item before pushing it.
+         * @param item An item.
+         * @return True if push() would keep the item, false otherwise.
+         */
+        bool
+        admits(const T& item) const {
+            return capacity == 0 || heap.size() < capacity ||
+                less(heap.front(), item);
+        };
+
+        /** Add an item.
+         * If the heap is full, the least item is removed to make room, or
+         * the item isn't added if it's not greater than the least item.
+         * @param item Item to add.
+         */
+        void
+        push(T item) {
+            if (!admits(item))
+                return;
+
+            auto cmp = [this](const T& a, const T& b) {
+                return greater(a, b);
+            };
+            if (capacity != 0 && heap.size() == capacity) {
+                std::pop_heap(heap.begin(), heap.end(), cmp);
+                heap.back() = std::move(item);
+            }
+            else
+                heap.push_back(std::move(item));
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        };
+
+        /** Remove the kept items.
+         * @return The kept items, greatest first.
+         */
+        std::vector<T>
+        take() {
+            std::sort_heap(heap.begin(), heap.end(),
+                [this](const T& a, const T& b) { return greater(a, b); });
+            std::vector<T> items;
+            items.swap(heap);
+
+            return items;
+        };
+
+        /** Get the number of kept items.
+         * @return Number of kept items.
+         */
+        size_t
+        size() const {
+            return heap.size();
+        };
+    };
+}
+
+#endif // TOPK_H
@@ -0,0 +1,389 @@
+#include "walker.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "config.h"
+#include "options.h"
+#include "pdf.h"
+
+#ifdef __linux__
+    #include <sys/syscall.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <dirent.h>
+    #include <unistd.h>
+#endif
+
+std::unique_ptr<Pdfsearch::Walker>
+Pdfsearch::Walker::create(const std::string& name, int threads) {
+    if (threads < 1)
+        throw std::invalid_argument("number of walker threads is not positive");
+
+    if (name == "boost" && threads == 1)
+        return std::unique_ptr<Walker>(new BoostWalker());
+    else if (name == "boost")
+        throw std::invalid_argument("boost walker can't use many threads");
+#ifdef __linux__
+    else if (name == "getdents" && threads == 1)
+        return std::unique_ptr<Walker>(new GetdentsWalker());
+    else if (name == "getdents")
+        return std::unique_ptr<Walker>(new ParallelWalker(threads));
+#endif
+
+    throw std::invalid_argument("unknown walker '" + name + "'");
+}
+
+void
+Pdfsearch::BoostWalker::walk(const std::string& directory, const int MAX_DEPTH,
+        const found_callback& found, const error_callback& error) {
+    walkDirectory(directory, 0, MAX_DEPTH, found, error);
+}
+
+void
+Pdfsearch::BoostWalker::walkDirectory(const std::string& directory, int depth,
+        const int MAX_DEPTH, const found_callback& found,
+        const error_callback& error) {
+    namespace fs = boost::filesystem;
+
+    auto end = fs::directory_iterator();
+    for (auto it = fs::directory_iterator(directory); it != end && !stopped;
+            ++it) {
+        try {
+            if (fs::is_directory(it->path()) && !fs::is_symlink(it->path()) &&
+                    (MAX_DEPTH == Options::RECURSE_INFINITELY || depth < MAX_DEPTH)) {
+                walkDirectory(it->path().native(), depth + 1, MAX_DEPTH, found,
+                    error);
+            }
+            else if (fs::is_regular_file(it->path()) &&
+                    !fs::is_symlink(it->path()) &&
+                    Pdf::filenameEndsToPdf(it->path().native())) {
+                found(fs::canonical(it->path()).native(),
+                    fs::last_write_time(it->path()));
+            }
+        }
+        catch (const std::exception& e) {
+            error(e);
+        }
+    }
+}
+
+#ifdef __linux__
+/* An entry returned by getdents64(), glibc declares it only since 2.30. */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[256];
+};
+
+/* Size of the buffer for directory entries. */
+static const size_t ENTRIES_SIZE = 32 * 1024;
+
+/* Closes a file descriptor when it goes out of scope. */
+class FileDescriptor {
+private:
+    int fd;
+public:
+    explicit FileDescriptor(int fd) : fd(fd) {};
+    FileDescriptor(const FileDescriptor& other) = delete;
+    FileDescriptor& operator=(const FileDescriptor& other) = delete;
+    ~FileDescriptor() { ::close(fd); };
+    int get() const { return fd; };
+};
+
+/* Called for a subdirectory with the file descriptor of its parent, its name
+ * and its path. */
+typedef std::function<void(int fd, const char* name, const std::string& path)>
+    directory_callback;
+
+static void
+readDirectory(int fd, std::string& path, bool descend,
+    const std::atomic<bool>& stopped,
+    const Pdfsearch::Walker::found_callback& found,
+    const Pdfsearch::Walker::error_callback& error,
+    const directory_callback& directory);
+
+static unsigned char
+entryType(int dirfd, const char* name, const std::string& path);
+
+static bool
+statPdf(int dirfd, const char* name, const std::string& path,
+    std::time_t& lastModified);
+
+static std::string
+realPath(const std::string& directory);
+
+static int
+openDirectory(const std::string& path);
+
+void
+Pdfsearch::GetdentsWalker::walk(const std::string& directory,
+        const int MAX_DEPTH, const found_callback& found,
+        const error_callback& error) {
+    std::string path(realPath(directory));
+    FileDescriptor dir(openDirectory(path));
+
+    /* Names are appended with a slash. */
+    if (path == "/")
+        path.clear();
+    walkDirectory(dir.get(), path, 0, MAX_DEPTH, found, error);
+}
+
+void
+Pdfsearch::GetdentsWalker::walkDirectory(int fd, std::string& path, int depth,
+        const int MAX_DEPTH, const found_callback& found,
+        const error_callback& error) {
+    const bool descend = MAX_DEPTH == Options::RECURSE_INFINITELY ||
+        depth < MAX_DEPTH;
+    readDirectory(fd, path, descend, stopped, found, error,
+        [&](int parent, const char* name, const std::string&) {
+            int child = ::openat(parent, name,
+                O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child == -1)
+                throw std::system_error(errno, std::generic_category(), path);
+            FileDescriptor dir(child);
+            walkDirectory(dir.get(), path, depth + 1, MAX_DEPTH, found, error);
+        });
+}
+
+Pdfsearch::ParallelWalker::ParallelWalker(int threads) : threads(threads) {
+    if (threads < 1)
+        throw std::invalid_argument("number of walker threads is not positive");
+}
+
+void
+Pdfsearch::ParallelWalker::walk(const std::string& directory,
+        const int MAX_DEPTH, const found_callback& found,
+        const error_callback& error) {
+    std::string root(realPath(directory));
+    ::close(openDirectory(root));
+    if (root == "/")
+        root.clear();
+
+    std::vector<Queue> queues(threads);
+    queues[0].tasks.push_back(Task{ root, 0 });
+    /* Directories queued or being read. */
+    std::atomic<long> pending(1);
+    /* Directories queued, and idle threads waiting for one. A thread
+     * queuing a directory sees the waiting thread or the waiting thread
+     * sees the directory. */
+    std::atomic<long> queued(1);
+    std::atomic<int> waiting(0);
+
+    auto work = [&](int self) {
+        Task task;
+        while (pending > 0 && !stopped) {
+            if (!popTask(queues, self, task)) {
+                std::unique_lock<std::mutex> lock(idleMutex);
+                waiting++;
+                workQueued.wait(lock, [&]() {
+                    return queued > 0 || pending == 0 || stopped;
+                });
+                waiting--;
+                continue;
+            }
+            queued--;
+
+            try {
+                FileDescriptor dir(openDirectory(
+                    task.path.empty() ? "/" : task.path));
+                const bool descend = MAX_DEPTH == Options::RECURSE_INFINITELY ||
+                    task.depth < MAX_DEPTH;
+                readDirectory(dir.get(), task.path, descend, stopped, found,
+                    error,
+                    [&](int, const char*, const std::string& path) {
+                        pending++;
+                        {
+                            std::lock_guard<std::mutex> lock(
+                                queues[self].mutex);
+                            queues[self].tasks.push_back(
+                                Task{ path, task.depth + 1 });
+                        }
+                        queued++;
+                        if (waiting > 0) {
+                            std::lock_guard<std::mutex> lock(idleMutex);
+                            workQueued.notify_one();
+                        }
+                    });
+            }
+            catch (const std::exception& e) {
+                error(e);
+            }
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                workQueued.notify_all();
+            }
+        }
+    };
+
+    /* The calling thread is one of the workers. */
+    std::vector<std::thread> workers;
+    try {
+        for (int i = 1; i < threads; i++)
+            workers.emplace_back(work, i);
+    }
+    catch (const std::system_error& e) {
+        error(e);
+    }
+    work(0);
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void
+Pdfsearch::ParallelWalker::stop() {
+    Walker::stop();
+    std::lock_guard<std::mutex> lock(idleMutex);
+    workQueued.notify_all();
+}
+
+bool
+Pdfsearch::ParallelWalker::popTask(std::vector<Queue>& queues, int self,
+        Task& task) {
+    /* Own directories are read depth first, others' are stolen from the
+     * top of the tree, where the biggest subtrees are. */
+    {
+        Queue& own = queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+readDirectory(int fd, std::string& path, bool descend,
+        const std::atomic<bool>& stopped,
+        const Pdfsearch::Walker::found_callback& found,
+        const Pdfsearch::Walker::error_callback& error,
+        const directory_callback& directory) {
+    std::vector<char> entries(ENTRIES_SIZE);
+    const size_t length = path.size();
+
+    while (!stopped) {
+        long n = ::syscall(SYS_getdents64, fd, entries.data(), entries.size());
+        if (n == -1) {
+            path.resize(length);
+            error(std::system_error(errno, std::generic_category(), path));
+            break;
+        }
+        else if (n == 0)
+            break;
+
+        for (long offset = 0; offset < n;) {
+            const auto* entry =
+                reinterpret_cast<const linux_dirent64*>(&entries[offset]);
+            offset += entry->d_reclen;
+
+            const char* name = entry->d_name;
+            if (::strcmp(name, ".") == 0 || ::strcmp(name, "..") == 0)
+                continue;
+
+            path.resize(length);
+            path += '/';
+            path += name;
+            try {
+                unsigned char type = entry->d_type;
+                if (type == DT_UNKNOWN)
+                    type = entryType(fd, name, path);
+
+                if (type == DT_DIR && descend)
+                    directory(fd, name, path);
+                else if (type == DT_REG &&
+                        Pdfsearch::Pdf::filenameEndsToPdf(name,
+                            ::strlen(name))) {
+                    std::time_t lastModified;
+                    if (statPdf(fd, name, path, lastModified))
+                        found(path, lastModified);
+                }
+            }
+            catch (const std::exception& e) {
+                error(e);
+            }
+        }
+    }
+
+    path.resize(length);
+}
+
+/* Some filesystems don't return the type of an entry. */
+static unsigned char
+entryType(int dirfd, const char* name, const std::string& path) {
+    struct stat st;
+    if (::fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+        throw std::system_error(errno, std::generic_category(), path);
+
+    if (S_ISDIR(st.st_mode))
+        return DT_DIR;
+    else if (S_ISREG(st.st_mode))
+        return DT_REG;
+
+    return DT_UNKNOWN;
+}
+
+/* Returns false if the entry isn't a regular file anymore. */
+static bool
+statPdf(int dirfd, const char* name, const std::string& path,
+        std::time_t& lastModified) {
+#ifdef HAVE_STATX
+    struct statx st;
+    if (::statx(dirfd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT,
+            STATX_TYPE | STATX_MTIME, &st) == -1) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    lastModified = st.stx_mtime.tv_sec;
+
+    return S_ISREG(st.stx_mode);
+#else
+    struct stat st;
+    if (::fstatat(dirfd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+        throw std::system_error(errno, std::generic_category(), path);
+    lastModified = st.st_mtime;
+
+    return S_ISREG(st.st_mode);
+#endif
+}
+
+static std::string
+realPath(const std::string& directory) {
+    char* real = ::realpath(directory.c_str(), nullptr);
+    if (!real)
+        throw std::system_error(errno, std::generic_category(), directory);
+    std::string path(real);
+    std::free(real);
+
+    return path;
+}
+
+static int
+openDirectory(const std::string& path) {
+    int fd = ::open(path.c_str(),
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1)
+        throw std::system_error(errno, std::generic_category(), path);
+
+    return fd;
+}
+#endif
@@ -0,0 +1,172 @@
+#ifndef WALKER_H
+    #define WALKER_H
+
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+namespace Pdfsearch {
+    /** A base class for finding pdfs from a directory tree.
+     * Symbolic links are not followed. Walkers using many threads call the
+     * callbacks concurrently.
+     * Example usage:
+     * @code
+       auto walker(Pdfsearch::Walker::create("getdents"));
+       walker->walk(directory, Options::RECURSE_INFINITELY,
+           [](const std::string& file, std::time_t lastModified) {
+               // ...
+           },
+           [](const std::exception& e) {
+               // ...
+           });
+       @endcode
+     * @note The class is non-copyable.
+     */
+    class Walker {
+    protected:
+        /* Set by stop(). */
+        std::atomic<bool> stopped;
+    public:
+        /** Called for every pdf found, with the canonical filename and last
+         * modification time of the pdf. */
+        typedef std::function<void(const std::string& file,
+            std::time_t lastModified)> found_callback;
+        /** Called for every file or directory which couldn't be read. */
+        typedef std::function<void(const std::exception& e)> error_callback;
+
+        /** Constructor. */
+        Walker() : stopped(false) {};
+        /** Non-copyable. */
+        Walker(const Walker& other) = delete;
+        /** Non-copyable. */
+        Walker& operator=(const Walker& other) = delete;
+        /** Non-copyable. */
+        Walker(Walker&& other) = delete;
+        /** Non-copyable. */
+        Walker& operator=(Walker&& other) = delete;
+        /** Destructor. */
+        virtual ~Walker() {};
+
+        /** Find pdfs from a directory.
+         * @param directory Directory where to look for pdfs.
+         * @param MAX_DEPTH A maximum depth to recurse in a directory.
+         * Options::RECURSE_INFINITELY to recurse indefinitely, 0 to
+         * not to recurse at all.
+         * @param found Called for every pdf.
+         * @param error Called for every entry which couldn't be read.
+         * @throws std::runtime_error if @p directory can't be read.
+         */
+        virtual void
+        walk(const std::string& directory, const int MAX_DEPTH,
+            const found_callback& found, const error_callback& error) = 0;
+
+        /** Stop walking.
+         * Can be called from another thread or from a callback. A running
+         * walk() and later calls return soon without finding more pdfs.
+         */
+        virtual void
+        stop() { stopped = true; };
+
+        /** Create a walker.
+         * @param name "boost" for a portable walker using
+         * boost::filesystem, "getdents" for a Linux walker which reads
+         * directories with getdents64() and stats only pdfs.
+         * @param threads Number of threads reading directories, > 0. Only
+         * the getdents walker can use more than one thread.
+         * @return A walker.
+         * @throws std::invalid_argument if @p name is unknown, the walker
+         * isn't supported on this platform or can't use @p threads threads.
+         */
+        static std::unique_ptr<Walker>
+        create(const std::string& name, int threads = 1);
+    };
+
+    /** A walker using boost::filesystem.
+     * Stats every entry in the directory tree.
+     */
+    class BoostWalker : public Walker {
+    private:
+        void
+        walkDirectory(const std::string& directory, int depth,
+            const int MAX_DEPTH, const found_callback& found,
+            const error_callback& error);
+    public:
+        void
+        walk(const std::string& directory, const int MAX_DEPTH,
+            const found_callback& found, const error_callback& error) override;
+    };
+
+#ifdef __linux__
+    /** A walker using getdents64() and the type of an entry in a directory.
+     * Directories are opened relative to their parent with openat() and
+     * only files whose name ends to '.pdf' are stat'd. Entries of unknown
+     * type are stat'd to get their type.
+     */
+    class GetdentsWalker : public Walker {
+    private:
+        void
+        walkDirectory(int fd, std::string& path, int depth,
+            const int MAX_DEPTH, const found_callback& found,
+            const error_callback& error);
+    public:
+        void
+        walk(const std::string& directory, const int MAX_DEPTH,
+            const found_callback& found, const error_callback& error) override;
+    };
+
+    /** A getdents64() walker which reads directories in many threads.
+     * Every thread has a deque of directories to read. A thread pushes
+     * subdirectories it finds to the back of its own deque and reads them
+     * depth first. An idle thread steals directories from the front of
+     * other threads' deques, or waits until one is queued if they're all
+     * empty. Directories are opened by their path.
+     */
+    class ParallelWalker : public Walker {
+    private:
+        /* A directory to read. */
+        struct Task {
+            std::string path;
+            int depth;
+        };
+
+        /* Directories to read by one thread. */
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        const int threads;
+        /* Idle threads wait until a directory is queued, the walk ends or
+         * it's stopped. */
+        std::mutex idleMutex;
+        std::condition_variable workQueued;
+
+        // Take a task from own queue or steal one from others' queues.
+        // @return False if all queues are empty.
+        static bool
+        popTask(std::vector<Queue>& queues, int self, Task& task);
+    public:
+        /** Constructor.
+         * @param threads Number of threads, > 0.
+         * @throws std::invalid_argument if @p threads isn't positive.
+         */
+        explicit ParallelWalker(int threads);
+
+        void
+        walk(const std::string& directory, const int MAX_DEPTH,
+            const found_callback& found, const error_callback& error) override;
+
+        void
+        stop() override;
+    };
+#endif
+}
+
+#endif // WALKER_H
@@ -0,0 +1,337 @@
+#include "workerprocess.h"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include "pdf.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/* A reply of the worker is zero or more page frames, at most one error frame
+ * and a done frame. Page and error frames have a length and the data, the
+ * done frame has the memory growth of the worker. */
+static const char PAGE_FRAME = 'P';
+static const char ERROR_FRAME = 'E';
+static const char DONE_FRAME = 'D';
+
+/* A worker runs this program again with the option and the number of its
+ * socket. */
+static const char* const SELF = "/proc/self/exe";
+static const char* const WORKER_OPTION = "--worker";
+static const char* const MMAP_OPTION = "--mmap";
+
+static void
+writeAll(int fd, const void* buffer, size_t size);
+
+static void
+writeFrame(int fd, char type, const std::string& data);
+
+static bool
+readAll(int fd, void* buffer, size_t size, int timeout,
+    Clock::time_point deadline);
+
+static void
+closeOtherFiles(int keep);
+
+static long
+residentMemory();
+
+Pdfsearch::WorkerProcess::WorkerProcess(int timeout, bool mmap) :
+        pid(-1),
+        socket(-1),
+        timeout(timeout),
+        documents(0),
+        memoryGrowth(0) {
+    /* Close-on-exec, so a worker started by another thread at the same time
+     * doesn't keep this worker's socket open. */
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+        throw std::system_error(errno, std::generic_category(), "socketpair");
+
+    /* The parent may have other threads, so the child only makes async
+     * signal safe calls until it runs the program again as a worker. The
+     * arguments are built before the fork. */
+    const std::string fd(std::to_string(fds[1]));
+    char* const argv[] = {
+        const_cast<char*>(SELF),
+        const_cast<char*>(WORKER_OPTION),
+        const_cast<char*>(fd.c_str()),
+        const_cast<char*>(mmap ? MMAP_OPTION : nullptr),
+        nullptr
+    };
+
+    pid = ::fork();
+    if (pid == -1) {
+        int error = errno;
+        ::close(fds[0]);
+        ::close(fds[1]);
+        throw std::system_error(error, std::generic_category(), "fork");
+    }
+    else if (pid == 0) {
+        /* Ctrl-C goes to the whole process group, the parent stops the
+         * worker when it's done. An ignored signal stays ignored after
+         * exec, handlers are reset. */
+        ::signal(SIGINT, SIG_IGN);
+        if (::fcntl(fds[1], F_SETFD, 0) != -1)
+            ::execve(SELF, argv, environ);
+        /* The parent sees end of file as if the worker had crashed. */
+        ::_exit(EXIT_FAILURE);
+    }
+
+    ::close(fds[1]);
+    socket = fds[0];
+}
+
+void
+Pdfsearch::WorkerProcess::runIfWorker(int argc, char** argv) {
+    if (argc < 3 || std::strcmp(argv[1], WORKER_OPTION) != 0)
+        return;
+
+    int socket = std::atoi(argv[2]);
+    bool mmap = argc > 3 && std::strcmp(argv[3], MMAP_OPTION) == 0;
+    /* Files opened without close-on-exec are still open, the worker only
+     * uses its own socket and poppler. */
+    closeOtherFiles(socket);
+    try {
+        serve(socket, mmap);
+    }
+    catch (...) {
+        ::_exit(EXIT_FAILURE);
+    }
+    ::_exit(EXIT_SUCCESS);
+}
+
+Pdfsearch::WorkerProcess::~WorkerProcess() {
+    if (pid > 0) {
+        /* The worker exits when it reads end of file. */
+        ::close(socket);
+        int status;
+        while (::waitpid(pid, &status, 0) == -1 && errno == EINTR)
+            ;
+    }
+}
+
+std::vector<std::string>
+Pdfsearch::WorkerProcess::extract(const std::string& file) {
+    if (!isRunning())
+        throw std::runtime_error("worker process is not running");
+
+    const auto deadline = Clock::now() + std::chrono::seconds(timeout);
+    /* Kills the worker if it doesn't reply in time or has died. */
+    auto receive = [&](void* buffer, size_t size) {
+        std::ostringstream error;
+        error << "text extraction of '" << file << "' ";
+        try {
+            if (readAll(socket, buffer, size, timeout, deadline))
+                return;
+            error << "crashed";
+        }
+        catch (const std::system_error& e) {
+            error << "failed: " << e.what();
+        }
+        catch (const std::runtime_error&) {
+            error << "timed out";
+        }
+        kill();
+        throw std::runtime_error(error.str());
+    };
+
+    try {
+        uint32_t length = file.size();
+        writeAll(socket, &length, sizeof(length));
+        writeAll(socket, file.data(), length);
+    }
+    catch (const std::system_error&) {
+        kill();
+        throw;
+    }
+
+    std::vector<std::string> pages;
+    std::string error;
+    for (;;) {
+        char type;
+        receive(&type, sizeof(type));
+        if (type == PAGE_FRAME || type == ERROR_FRAME) {
+            uint32_t length;
+            receive(&length, sizeof(length));
+            std::string data(length, '\0');
+            receive(&data[0], length);
+
+            if (type == PAGE_FRAME)
+                pages.push_back(std::move(data));
+            else
+                error = std::move(data);
+        }
+        else if (type == DONE_FRAME) {
+            int64_t growth;
+            receive(&growth, sizeof(growth));
+            memoryGrowth = growth;
+            break;
+        }
+        else {
+            kill();
+            throw std::runtime_error("invalid reply from worker process");
+        }
+    }
+    documents++;
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+
+    return pages;
+}
+
+void
+Pdfsearch::WorkerProcess::serve(int socket, bool mmap) {
+    const long baseline = residentMemory();
+
+    uint32_t length;
+    /* Text of every page is written from the same buffer. */
+    std::string page;
+    while (readAll(socket, &length, sizeof(length), 0, Clock::time_point())) {
+        std::string file(length, '\0');
+        if (!readAll(socket, &file[0], length, 0, Clock::time_point()))
+            return;
+
+        try {
+            Pdf doc(file, mmap);
+            for (int i = 0; i < doc.numberOfPages(); i++) {
+                doc.getPage(i, page);
+                writeFrame(socket, PAGE_FRAME, page);
+            }
+        }
+        catch (const std::system_error&) {
+            throw;
+        }
+        catch (const std::exception& e) {
+            writeFrame(socket, ERROR_FRAME, e.what());
+        }
+
+        int64_t growth = residentMemory() - baseline;
+        writeAll(socket, &DONE_FRAME, sizeof(DONE_FRAME));
+        writeAll(socket, &growth, sizeof(growth));
+    }
+}
+
+void
+Pdfsearch::WorkerProcess::kill() {
+    if (pid <= 0)
+        return;
+
+    ::kill(pid, SIGKILL);
+    int status;
+    while (::waitpid(pid, &status, 0) == -1 && errno == EINTR)
+        ;
+    ::close(socket);
+    pid = -1;
+    socket = -1;
+}
+
+static void
+writeAll(int fd, const void* buffer, size_t size) {
+    const char* p = static_cast<const char*>(buffer);
+    while (size > 0) {
+        ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "send");
+        }
+        p += n;
+        size -= n;
+    }
+}
+
+static void
+writeFrame(int fd, char type, const std::string& data) {
+    uint32_t length = data.size();
+    writeAll(fd, &type, sizeof(type));
+    writeAll(fd, &length, sizeof(length));
+    writeAll(fd, data.data(), length);
+}
+
+/* Returns false on end of file. Throws std::runtime_error if timeout > 0 and
+ * deadline is exceeded, std::system_error on read errors. */
+static bool
+readAll(int fd, void* buffer, size_t size, int timeout,
+        Clock::time_point deadline) {
+    char* p = static_cast<char*>(buffer);
+    while (size > 0) {
+        if (timeout > 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - Clock::now()).count();
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int result = left > 0 ? ::poll(&pfd, 1, left) : 0;
+            if (result == -1 && errno == EINTR)
+                continue;
+            else if (result == -1)
+                throw std::system_error(errno, std::generic_category(), "poll");
+            else if (result == 0)
+                throw std::runtime_error("timeout");
+        }
+
+        ssize_t n = ::read(fd, p, size);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        else if (n == 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/* The worker mustn't keep other workers' sockets or the database open. */
+static void
+closeOtherFiles(int keep) {
+    std::vector<int> fds;
+    DIR* dir = ::opendir("/proc/self/fd");
+    if (dir) {
+        while (struct dirent* entry = ::readdir(dir)) {
+            int fd = std::atoi(entry->d_name);
+            if (fd > STDERR_FILENO && fd != keep && fd != ::dirfd(dir))
+                fds.push_back(fd);
+        }
+        ::closedir(dir);
+    }
+    else {
+        for (long fd = STDERR_FILENO + 1; fd < ::sysconf(_SC_OPEN_MAX); fd++) {
+            if (fd != keep)
+                fds.push_back(fd);
+        }
+    }
+
+    for (int fd : fds)
+        ::close(fd);
+}
+
+/* Resident memory in bytes, 0 if it can't be read. */
+static long
+residentMemory() {
+    long size = 0;
+    long resident = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (statm) {
+        if (std::fscanf(statm, "%ld %ld", &size, &resident) != 2)
+            resident = 0;
+        std::fclose(statm);
+    }
+
+    return resident * ::sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,122 @@
+#ifndef WORKERPROCESS_H
+    #define WORKERPROCESS_H
+
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+namespace Pdfsearch {
+    /** A separate process which extracts text from pdfs.
+     * If poppler crashes, hangs or leaks memory on a pdf, only the worker
+     * process is affected. The caller gets an exception and can start a new
+     * worker.
+     * The worker is the program itself, started again from
+     * /proc/self/exe, so it can be started while other threads run. The
+     * program's main() has to call runIfWorker() first.
+     * Example usage:
+     * @code
+       std::unique_ptr<Pdfsearch::WorkerProcess> worker;
+       for (const auto& file : files) {
+           try {
+               if (!worker)
+                   worker.reset(new Pdfsearch::WorkerProcess(timeout));
+               auto pages(worker->extract(file));
+               // ...
+           }
+           catch (const std::runtime_error& e) {
+               if (!worker->isRunning())
+                   worker.reset();
+               // ...
+       @endcode
+     * @note The class is non-copyable.
+     */
+    class WorkerProcess {
+    private:
+        pid_t pid;
+        /* Parent's end of the socket pair. */
+        int socket;
+        /* Seconds to wait for one pdf, 0 to wait forever. */
+        int timeout;
+        /* Number of pdfs extracted. */
+        int documents;
+        /* Growth of the resident memory of the worker in bytes. */
+        long memoryGrowth;
+
+        // Loop of the child process, reads filenames and writes pages.
+        static void
+        serve(int socket, bool mmap);
+
+        // Kill and reap the child process.
+        void
+        kill();
+    public:
+        /** Start a new worker process.
+         * @param timeout Seconds to wait for the text of one pdf before the
+         * worker is killed, 0 to wait forever.
+         * @param mmap Map pdfs to memory instead of reading them, see
+         * Pdf#Pdf(const std::string&, bool).
+         * @throws std::system_error if can't create the process.
+         */
+        explicit WorkerProcess(int timeout, bool mmap = false);
+
+        /** Serve as a worker if the program was started by WorkerProcess.
+         * Call at the start of main(), before the options are parsed.
+         * @param argc Number of arguments of main().
+         * @param argv Arguments of main().
+         * @return Doesn't return in a worker process.
+         */
+        static void
+        runIfWorker(int argc, char** argv);
+
+        /** Non-copyable. */
+        WorkerProcess(const WorkerProcess& other) = delete;
+        /** Non-copyable. */
+        WorkerProcess& operator=(const WorkerProcess& other) = delete;
+        /** Non-copyable. */
+        WorkerProcess(WorkerProcess&& other) = delete;
+        /** Non-copyable. */
+        WorkerProcess& operator=(WorkerProcess&& other) = delete;
+
+        /** Destructor.
+         * Stops the worker process and waits for it to exit.
+         */
+        ~WorkerProcess();
+
+        /** Extract text of every page of a pdf.
+         * @param file Pdf filename.
+         * @return Text of the pages.
+         * @throws std::runtime_error if the pdf can't be loaded, or if the
+         * worker crashed or timed out, in which case isRunning() returns
+         * false afterwards.
+         */
+        std::vector<std::string>
+        extract(const std::string& file);
+
+        /** Check whether the worker process is still usable.
+         * @return False if the worker has crashed or has been killed.
+         */
+        bool
+        isRunning() const {
+            return pid > 0;
+        };
+
+        /** Get the number of extracted pdfs.
+         * @return Number of pdfs extracted by this worker.
+         */
+        int
+        getDocuments() const {
+            return documents;
+        };
+
+        /** Get the growth of the worker's resident memory.
+         * @return Bytes the resident memory has grown since the worker
+         * started.
+         */
+        long
+        getMemoryGrowth() const {
+            return memoryGrowth;
+        };
+    };
+}
+
+#endif // WORKERPROCESS_H
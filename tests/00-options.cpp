@@ -9,15 +9,42 @@ TEST_CASE("default options", "[options]") {
     const char* argv[] = { "" };
     Pdfsearch::Options o(1, const_cast<char**>(argv));
 
+    REQUIRE(o.getAfterContext() == 5);
+    REQUIRE(o.getBeforeContext() == 5);
+    REQUIRE(!o.getBulk());
+    REQUIRE(!o.getCreateFullText());
+    REQUIRE(!o.getCreateSubstring());
+    REQUIRE(!o.getFullText());
+    REQUIRE(!o.getFilesWithMatches());
+    REQUIRE(o.getBusyTimeout() == 5000);
+    REQUIRE(o.getJournalMode().empty());
+    REQUIRE(o.getWalAutocheckpoint() == 1000);
+    REQUIRE(o.getCommitEvery() == 0);
+    REQUIRE(o.getCommitSeconds() == 0);
     REQUIRE(o.getConfig() == CONFIG_FILE);
     REQUIRE(o.getDatabase() == DATABASE_FILE);
     REQUIRE(o.getDirectories().at(0) == ".");
     REQUIRE(!o.getHelp());
     REQUIRE(!o.getIndex());
+    REQUIRE(o.getJobs() == 1);
+    REQUIRE(!o.getProcesses());
+    REQUIRE(o.getMaxDocuments() == 0);
+    REQUIRE(o.getMaxMemory() == 0);
+    REQUIRE(!o.getMmap());
+    REQUIRE(o.getTimeout() == 0);
+    REQUIRE(o.getWalker() == "boost");
+    REQUIRE(o.getWalkJobs() == 1);
     REQUIRE(!o.getUpdate());
     REQUIRE(o.getMatches() == Pdfsearch::Options::UNLIMITED_MATCHES);
     REQUIRE(o.getQuery().empty());
     REQUIRE(o.getRecursion() == Pdfsearch::Options::RECURSE_INFINITELY);
+    REQUIRE(o.getSort().empty());
+    REQUIRE(!o.getRegularExpression());
+    REQUIRE(o.getFuzzy() == 0);
+    REQUIRE(!o.getBatch());
+    REQUIRE(!o.getNullSeparated());
+    REQUIRE(o.getServe().empty());
+    REQUIRE(o.getConnect().empty());
     REQUIRE(!o.getVacuum());
     REQUIRE(!o.getVerbose());
 }
@@ -90,11 +117,32 @@ TEST_CASE("config", "[options]") {
     decltype(dirs) expectedDirs{ "a,b", "c", "€öäå" };
 
     REQUIRE(o.getDatabase() == "t.sqlite");
+    REQUIRE(o.getAfterContext() == 3);
+    REQUIRE(o.getBeforeContext() == 2);
+    REQUIRE(o.getBulk());
+    REQUIRE(o.getFullText());
+    REQUIRE(o.getFuzzy() == 2);
+    REQUIRE(o.getFilesWithMatches());
+    REQUIRE(o.getBusyTimeout() == 100);
+    REQUIRE(o.getJournalMode() == "wal");
+    REQUIRE(o.getWalAutocheckpoint() == 200);
+    REQUIRE(o.getCommitEvery() == 50);
+    REQUIRE(o.getCommitSeconds() == 30);
     REQUIRE(dirs.size() == expectedDirs.size());
     REQUIRE(std::equal(dirs.begin(), dirs.end(), expectedDirs.begin(),
         std::equal_to<std::string>()));
     REQUIRE(o.getMatches() == 5);
+    REQUIRE(o.getJobs() == 4);
+    REQUIRE(o.getProcesses());
+    REQUIRE(o.getMaxDocuments() == 100);
+    REQUIRE(o.getMaxMemory() == 512);
+    REQUIRE(o.getMmap());
+    REQUIRE(o.getTimeout() == 60);
+    REQUIRE(o.getWalker() == "getdents");
+    REQUIRE(o.getWalkJobs() == 8);
     REQUIRE(o.getRecursion() == 3);
+    REQUIRE(o.getSort() == "relevance");
+    REQUIRE(o.getRegularExpression());
     REQUIRE(o.getVerbose());
 }
 
@@ -208,6 +256,303 @@ TEST_CASE("validate - negative matches", "[options]") {
     REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
 }
 
+TEST_CASE("validate - jobs not positive", "[options]") {
+    const char* argv[] = { "", "-i", "-j0" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("jobs", "[options]") {
+    const char* argv[] = { "", "-i", "--jobs=8" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getJobs() == 8);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("worker processes", "[options]") {
+    const char* argv[] = { "", "-i", "-P", "--max-documents=10",
+        "--max-memory", "256", "--timeout=30" };
+    Pdfsearch::Options o(7, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getProcesses());
+    REQUIRE(o.getMaxDocuments() == 10);
+    REQUIRE(o.getMaxMemory() == 256);
+    REQUIRE(o.getTimeout() == 30);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - negative timeout", "[options]") {
+    const char* argv[] = { "", "-i", "--timeout=-1" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("validate - unknown walker", "[options]") {
+    const char* argv[] = { "", "-i", "--walker=find" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("mmap", "[options]") {
+    const char* argv[] = { "", "-i", "--mmap" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getMmap());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("bulk", "[options]") {
+    const char* argv[] = { "", "-i", "--bulk" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getBulk());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("commit limits", "[options]") {
+    const char* argv[] = { "", "-u", "--commit-every=100",
+        "--commit-seconds", "60" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getCommitEvery() == 100);
+    REQUIRE(o.getCommitSeconds() == 60);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - negative commit limit", "[options]") {
+    const char* argv[] = { "", "-i", "--commit-every=-1" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("database connection", "[options]") {
+    const char* argv[] = { "", "-qa", "-J", "wal", "--busy-timeout=10",
+        "--wal-autocheckpoint=0" };
+    Pdfsearch::Options o(6, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getJournalMode() == "wal");
+    REQUIRE(o.getBusyTimeout() == 10);
+    REQUIRE(o.getWalAutocheckpoint() == 0);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - unknown journal mode", "[options]") {
+    const char* argv[] = { "", "-qa", "--journal-mode=memory" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("full-text", "[options]") {
+    const char* argv[] = { "", "-f", "-qword" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getFullText());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("fuzzy", "[options]") {
+    const char* argv[] = { "", "-f", "--fuzzy=2", "-q", "kernel" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getFuzzy() == 2);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - fuzzy without full-text", "[options]") {
+    const char* argv[] = { "", "--fuzzy", "1", "-q", "kernel" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("create full-text", "[options]") {
+    const char* argv[] = { "", "--create-full-text" };
+    Pdfsearch::Options o(2, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getCreateFullText());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("create substring index", "[options]") {
+    const char* argv[] = { "", "--create-substring-index",
+        "--create-full-text" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getCreateSubstring());
+    REQUIRE(o.getCreateFullText());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - create full-text and index", "[options]") {
+    const char* argv[] = { "", "--create-full-text", "-i" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("walk jobs", "[options]") {
+    const char* argv[] = { "", "-i", "-w", "getdents", "--walk-jobs=4" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getWalkJobs() == 4);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - walk jobs with boost walker", "[options]") {
+    const char* argv[] = { "", "-i", "--walk-jobs=4" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("files with matches", "[options]") {
+    const char* argv[] = { "", "-lq", "a" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getFilesWithMatches());
+    REQUIRE(o.getQuery() == "a");
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("context", "[options]") {
+    const char* argv[] = { "", "-q", "a", "-B", "0", "--after-context=10" };
+    Pdfsearch::Options o(6, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getBeforeContext() == 0);
+    REQUIRE(o.getAfterContext() == 10);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - negative context", "[options]") {
+    const char* argv[] = { "", "-q", "a", "-A", "-1" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("sort", "[options]") {
+    const char* argv[] = { "", "-q", "a", "--sort=mtime" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getSort() == "mtime");
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - unknown sort", "[options]") {
+    const char* argv[] = { "", "-q", "a", "-s", "size" };
+    Pdfsearch::Options o(5, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("regex", "[options]") {
+    const char* argv[] = { "", "-E", "-q", "a.c" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getRegularExpression());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - full-text and regex", "[options]") {
+    const char* argv[] = { "", "-fE", "-q", "a" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("batch", "[options]") {
+    const char* argv[] = { "", "--batch", "-z", "-v" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getBatch());
+    REQUIRE(o.getNullSeparated());
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - batch and query", "[options]") {
+    const char* argv[] = { "", "--batch", "-q", "a" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("validate - null without batch", "[options]") {
+    const char* argv[] = { "", "-z", "-q", "a" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("serve", "[options]") {
+    const char* argv[] = { "", "--serve=/tmp/s.sock", "-j", "4" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getServe() == "/tmp/s.sock");
+    REQUIRE(o.getJobs() == 4);
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - serve and query", "[options]") {
+    const char* argv[] = { "", "--serve=/tmp/s.sock", "-q", "a" };
+    Pdfsearch::Options o(4, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
+TEST_CASE("connect", "[options]") {
+    const char* argv[] = { "", "--connect=/tmp/s.sock", "--batch" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE(o.getConnect() == "/tmp/s.sock");
+    REQUIRE_NOTHROW(o.validate());
+}
+
+TEST_CASE("validate - connect without query", "[options]") {
+    const char* argv[] = { "", "--connect=/tmp/s.sock", "-u" };
+    Pdfsearch::Options o(3, const_cast<char**>(argv));
+    o.getopt();
+
+    REQUIRE_THROWS_AS(o.validate(), std::invalid_argument);
+}
+
 TEST_CASE("validate - ok1", "[options]") {
     const char* argv[] = { "", "-i" };
     Pdfsearch::Options o(2, const_cast<char**>(argv));
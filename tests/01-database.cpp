@@ -1,4 +1,5 @@
 #include <thread>
+#include <atomic>
 #include <chrono>
 #include <vector>
 #include <string>
@@ -217,6 +218,472 @@ TEST_CASE("database index2", "[database]") {
     fs::remove(dbFile);
 }
 
+TEST_CASE("database index3", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+
+    SECTION("many jobs and walker threads index the same pdfs and pages as one job") {
+        IndexStats stats1;
+        REQUIRE_NOTHROW(stats1 = db.index(dirs, Options::RECURSE_INFINITELY));
+
+        Statement s(db, "select P.file, count(*) from pdfs P, plaintexts T "
+            "where T.pdfs_id = P.id group by P.file;");
+        std::set<std::tuple<std::string, int>> pagesBefore;
+        for (auto it = s.begin(); it != s.end(); it++) {
+            pagesBefore.insert(std::make_tuple(*(it.column<std::string>(0)),
+                *(it.column<int>(1))));
+        }
+        s.reset();
+
+        fs::remove(dbFile);
+        Database db2(dbFile);
+        db2.createDatabase();
+        IndexSettings settings;
+        settings.jobs = 4;
+        settings.walker = "getdents";
+        settings.walkJobs = 4;
+        IndexStats stats4;
+        REQUIRE_NOTHROW(stats4 = db2.index(dirs, Options::RECURSE_INFINITELY,
+            settings));
+
+        Statement s2(db2, "select P.file, count(*) from pdfs P, plaintexts T "
+            "where T.pdfs_id = P.id group by P.file;");
+        std::set<std::tuple<std::string, int>> pagesAfter;
+        for (auto it = s2.begin(); it != s2.end(); it++) {
+            pagesAfter.insert(std::make_tuple(*(it.column<std::string>(0)),
+                *(it.column<int>(1))));
+        }
+
+        REQUIRE(stats1.pdfs == stats4.pdfs);
+        REQUIRE(stats1.pages == stats4.pages);
+        REQUIRE(pagesBefore == pagesAfter);
+    }
+
+    SECTION("worker processes index the same pdfs as threads") {
+        IndexStats threads;
+        REQUIRE_NOTHROW(threads = db.index(dirs, Options::RECURSE_INFINITELY));
+
+        fs::remove(dbFile);
+        Database db2(dbFile);
+        db2.createDatabase();
+        IndexSettings settings;
+        settings.jobs = 2;
+        settings.processes = true;
+        // Recycle workers after every pdf.
+        settings.maxDocuments = 1;
+        IndexStats processes;
+        REQUIRE_NOTHROW(processes = db2.index(dirs,
+            Options::RECURSE_INFINITELY, settings));
+
+        REQUIRE(threads.pdfs == processes.pdfs);
+        REQUIRE(threads.pages == processes.pages);
+    }
+
+    SECTION("unchanged pdfs are skipped") {
+        IndexSettings settings;
+        settings.jobs = 2;
+
+        REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY, settings).pdfs > 0);
+        REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY, settings).pdfs == 0);
+    }
+
+    SECTION("commits in batches") {
+        IndexSettings settings;
+        settings.commitEvery = 1;
+        settings.commitSeconds = 1;
+
+        REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY, settings).pdfs > 0);
+        // No transaction is left open.
+        REQUIRE_NOTHROW(Statement(db, "begin;").step());
+        REQUIRE_NOTHROW(Statement(db, "rollback;").step());
+    }
+
+    SECTION("stopped index continues from the last commit") {
+        IndexSettings settings;
+        settings.commitEvery = 1;
+
+        Database::requestStop();
+        IndexStats stopped;
+        REQUIRE_NOTHROW(stopped = db.index(dirs, Options::RECURSE_INFINITELY,
+            settings));
+        REQUIRE(stopped.stopped);
+
+        // The stop request is consumed.
+        IndexStats rest;
+        REQUIRE_NOTHROW(rest = db.index(dirs, Options::RECURSE_INFINITELY,
+            settings));
+        REQUIRE(!rest.stopped);
+        REQUIRE(rest.pdfs > 0);
+        REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY, settings).pdfs == 0);
+    }
+
+    SECTION("bulk index builds the indexes of the tables") {
+        IndexSettings settings;
+        settings.bulk = true;
+        IndexStats stats;
+        REQUIRE_NOTHROW(stats = db.index(dirs, Options::RECURSE_INFINITELY,
+            settings));
+        REQUIRE(stats.pdfs > 0);
+
+        Statement s(db, "select count(*) from sqlite_master where type = "
+            "'index' and name in ('last_modified_index', 'pdfs_id_index');");
+        auto it = s.begin();
+        REQUIRE(*(it.column<int>(0)) == 2);
+        s.reset();
+
+        Statement s2(db, "select count(*) from PlainTexts T "
+            "where not exists (select 1 from Pdfs P where P.id = T.pdfs_id);");
+        auto it2 = s2.begin();
+        REQUIRE(*(it2.column<int>(0)) == 0);
+        s2.reset();
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database index error", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+
+    // A reader keeps the commits of the index failing.
+    Database reader(dbFile);
+    Statement s(reader, "select * from sqlite_master;");
+    auto it = s.begin();
+
+    // The error is thrown after the threads are stopped, the transaction
+    // is rolled back.
+    IndexSettings settings;
+    settings.jobs = 2;
+    settings.commitEvery = 1;
+    REQUIRE_THROWS_AS(db.index(dirs, Options::RECURSE_INFINITELY, settings),
+        DatabaseError);
+    s.reset();
+    Statement count(db, "select count(*) from Pdfs;");
+    REQUIRE(*count.begin().value<int>(0) == 0);
+    count.reset();
+
+    REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY, settings).pdfs > 0);
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database update error", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+    Statement(db, "insert into Pdfs(file, last_modified) "
+        "values('./pdfs/missing.pdf', 0);").step();
+
+    // A reader keeps the commit of the removed pdf failing.
+    Database reader(dbFile);
+    Statement s(reader, "select * from sqlite_master;");
+    auto it = s.begin();
+
+    // The transaction is rolled back, so the connection can update again.
+    IndexSettings settings;
+    settings.commitEvery = 1;
+    REQUIRE_THROWS_AS(db.update(settings), DatabaseError);
+    s.reset();
+    Statement count(db,
+        "select count(*) from Pdfs where file = './pdfs/missing.pdf';");
+    REQUIRE(*count.begin().value<int>(0) == 1);
+    count.reset();
+
+    REQUIRE_NOTHROW(db.update(settings));
+    REQUIRE(*count.begin().value<int>(0) == 0);
+    count.reset();
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database full-text query", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+
+    QuerySettings settings;
+    settings.fullText = true;
+
+    // Pages indexed before the full-text index was created are found.
+    REQUIRE_NOTHROW(db.index(dirs, Options::RECURSE_INFINITELY));
+    REQUIRE(!db.fullTextIndexCreated());
+    REQUIRE_THROWS_AS(db.query("unicode", settings), DatabaseError);
+    REQUIRE_NOTHROW(db.createFullTextIndex());
+    REQUIRE(db.fullTextIndexCreated());
+
+    std::vector<QueryResult> r;
+    REQUIRE_NOTHROW(r = db.query(u8"UnIcOdE", settings));
+    REQUIRE(r.size() > 0);
+    const auto pages = r.size();
+
+    SECTION("all words must be on a page") {
+        REQUIRE(db.query("unicode nosuchword", settings).empty());
+        REQUIRE(db.query("   ", settings).empty());
+        // FTS5 syntax is plain text.
+        REQUIRE_NOTHROW(db.query("unicode* ^NEAR", settings));
+        REQUIRE_THROWS_AS(db.query("\"unicode AND (", settings),
+            std::invalid_argument);
+    }
+
+    SECTION("verbose results have a snippet") {
+        settings.verbose = true;
+        settings.matches = 1;
+        REQUIRE_NOTHROW(r = db.query("unicode", settings));
+        REQUIRE(r.size() == 1);
+        REQUIRE(boost::regex_search(r.at(0).chunk,
+            boost::regex("unicode", boost::regex::icase)));
+        REQUIRE(r.at(0).page > 0);
+        REQUIRE(r.at(0).pages > 0);
+    }
+
+    SECTION("index follows deleted pdfs and vacuum") {
+        fs::path from("./pdfs/good1/good2/unicodeexample.pdf");
+        fs::path to = fs::canonical("./pdfs/good1/") / fs::path("temp.pdf");
+        fs::copy(from, to);
+        REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY).pdfs == 1);
+        REQUIRE(db.query("unicode", settings).size() > pages);
+
+        fs::remove(to);
+        REQUIRE_NOTHROW(db.update());
+        REQUIRE(db.query("unicode", settings).size() == pages);
+
+        REQUIRE_NOTHROW(db.vacuum());
+        REQUIRE(db.query("unicode", settings).size() == pages);
+        Statement s(db, "insert into PageIndex(PageIndex, rank) "
+            "values('integrity-check', 1);");
+        REQUIRE_NOTHROW(s.step());
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database boolean query", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+
+    for (const auto& sql : {
+            "insert into Pdfs(id, file, last_modified, pages)"
+                " values(1, 'a.pdf', 0, 4);",
+            "insert into PlainTexts(plain_text, page, pdfs_id)"
+                " values('kernel scheduler', 1, 1), ('kernel cfs rt', 2, 1),"
+                " ('Kernel CFS', 3, 1), ('the scheduler of a kernel', 4, 1);" }) {
+        Statement s(db, sql);
+        s.step();
+    }
+    db.createFullTextIndex();
+
+    QuerySettings settings;
+    settings.fullText = true;
+    settings.verbose = true;
+    auto pages = [&](const std::string& query) {
+        std::vector<int> pages;
+        for (const auto& r : db.query(query, settings))
+            pages.push_back(r.page);
+        std::sort(pages.begin(), pages.end());
+        return pages;
+    };
+
+    REQUIRE(pages("kernel AND (scheduler OR cfs) NOT rt") ==
+        std::vector<int>({ 1, 3, 4 }));
+    REQUIRE(pages("scheduler kernel") == std::vector<int>({ 1, 4 }));
+    REQUIRE(pages("\"kernel scheduler\"") == std::vector<int>({ 1 }));
+    REQUIRE(pages("rt OR \"kernel cfs\"") == std::vector<int>({ 2, 3 }));
+    REQUIRE(pages("kernel NOT scheduler NOT cfs").empty());
+
+    settings.filesWithMatches = true;
+    REQUIRE(db.query("cfs NOT rt", settings).size() == 1);
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database fuzzy query", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+
+    for (const auto& sql : {
+            "insert into Pdfs(id, file, last_modified, pages)"
+                " values(1, 'a.pdf', 0, 4);",
+            "insert into PlainTexts(plain_text, page, pdfs_id)"
+                " values('the kernel', 1, 1), ('Kernal panic', 2, 1),"
+                " ('kernels', 3, 1), ('colonel', 4, 1);" }) {
+        Statement s(db, sql);
+        s.step();
+    }
+
+    QuerySettings settings;
+    settings.fullText = true;
+    settings.verbose = true;
+    auto pages = [&](const std::string& query) {
+        std::vector<int> pages;
+        for (const auto& r : db.query(query, settings))
+            pages.push_back(r.page);
+        std::sort(pages.begin(), pages.end());
+        return pages;
+    };
+
+    settings.fuzzy = 1;
+    REQUIRE_THROWS_AS(pages("kernel"), DatabaseError);
+    db.createFullTextIndex();
+
+    REQUIRE(pages("kernel") == std::vector<int>({ 1, 2, 3 }));
+    REQUIRE(pages("KERNEL NOT panik") == std::vector<int>({ 1, 3 }));
+    REQUIRE(pages("\"kernal\"") == std::vector<int>({ 2 }));
+    REQUIRE(pages("xyzzy").empty());
+    settings.fuzzy = 4;
+    REQUIRE(pages("kernel") == std::vector<int>({ 1, 2, 3, 4 }));
+    settings.fuzzy = 0;
+    REQUIRE(pages("kernel") == std::vector<int>({ 1 }));
+
+    settings.fuzzy = 1;
+    settings.fullText = false;
+    REQUIRE_THROWS_AS(pages("kernel"), std::invalid_argument);
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database substring index", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    REQUIRE_NOTHROW(db.index(dirs, Options::RECURSE_INFINITELY));
+
+    QuerySettings settings;
+    settings.verbose = true;
+    auto pages = [&](const std::string& query) {
+        std::vector<std::tuple<std::string, int, std::string>> pages;
+        for (const auto& r : db.query(query, settings))
+            pages.push_back(std::make_tuple(r.file, r.page, r.chunk));
+        return pages;
+    };
+
+    const std::vector<std::string> queries{ "unicode", u8"UnIcOdE", "u_icode",
+        "uni%ode", "utf-8", "ut", "%", "_", u8"€öä", "nosuchtext" };
+    std::vector<decltype(pages(""))> scanned;
+    for (const auto& q : queries)
+        scanned.push_back(pages(q));
+
+    REQUIRE(!db.substringIndexCreated());
+    REQUIRE_NOTHROW(db.createSubstringIndex());
+    REQUIRE(db.substringIndexCreated());
+
+    // Same results with and without the index.
+    for (size_t i = 0; i < queries.size(); i++)
+        REQUIRE(pages(queries[i]) == scanned[i]);
+    REQUIRE(!scanned[0].empty());
+
+    // New pages are indexed.
+    fs::path from("./pdfs/good1/good2/unicodeexample.pdf");
+    fs::path to = fs::canonical("./pdfs/good1/") / fs::path("temp.pdf");
+    fs::copy(from, to);
+    REQUIRE(db.index(dirs, Options::RECURSE_INFINITELY).pdfs == 1);
+    REQUIRE(pages("unicode").size() > scanned[0].size());
+    fs::remove(to);
+    REQUIRE_NOTHROW(db.update());
+    REQUIRE(pages("unicode") == scanned[0]);
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database wal", "[database]") {
+    std::string dbFile("./testdb");
+    for (const auto& suffix : { "", "-wal", "-shm" })
+        fs::remove(dbFile + suffix);
+    std::vector<std::string> dirs{ "./pdfs/" };
+
+    DatabaseSettings settings;
+    settings.journalMode = "wal";
+    settings.busyTimeout = 1000;
+
+    {
+        Database db(dbFile, settings);
+        db.createDatabase();
+
+        Statement s(db, "PRAGMA journal_mode;");
+        auto it = s.begin();
+        REQUIRE(*(it.column<std::string>(0)) == "wal");
+        s.reset();
+
+        SECTION("queries aren't blocked by an index") {
+            // A blocked reader would fail after its busy timeout.
+            DatabaseSettings readerSettings(settings);
+            readerSettings.busyTimeout = 10;
+            Database reader(dbFile, readerSettings);
+            Statement count(reader, "select count(*) from Pdfs;");
+
+            // Every pdf is committed, the reader sees them before index()
+            // returns unless it doesn't run during the whole index.
+            bool seenWhileIndexing = false;
+            for (int i = 0; i < 10 && !seenWhileIndexing; i++) {
+                Statement(db, "delete from PlainTexts;").step();
+                Statement(db, "delete from Pdfs;").step();
+                std::atomic<bool> indexed(false);
+                std::atomic<bool> indexFailed(false);
+                std::thread indexer([&]() {
+                    try {
+                        IndexSettings indexSettings;
+                        indexSettings.commitEvery = 1;
+                        db.index(dirs, Options::RECURSE_INFINITELY,
+                            indexSettings);
+                    }
+                    catch (const std::exception&) {
+                        indexFailed = true;
+                    }
+                    indexed = true;
+                });
+
+                bool queryFailed = false;
+                while (!indexed) {
+                    try {
+                        reader.query("a", false, Options::UNLIMITED_MATCHES);
+                        const int pdfs = *count.begin().value<int>(0);
+                        count.reset();
+                        if (pdfs > 0 && !indexed)
+                            seenWhileIndexing = true;
+                    }
+                    catch (const std::exception&) {
+                        queryFailed = true;
+                    }
+                }
+                indexer.join();
+
+                REQUIRE(!indexFailed);
+                REQUIRE(!queryFailed);
+            }
+            REQUIRE(seenWhileIndexing);
+        }
+    }
+
+    for (const auto& suffix : { "", "-wal", "-shm" })
+        fs::remove(dbFile + suffix);
+}
+
+TEST_CASE("database unknown journal mode", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    DatabaseSettings settings;
+    settings.journalMode = "memory";
+
+    REQUIRE_THROWS_AS(Database db(dbFile, settings), DatabaseError);
+    fs::remove(dbFile);
+}
+
 TEST_CASE("database update", "[database]") {
     std::string dbFile("./testdb");
     fs::remove(dbFile);
@@ -247,6 +714,24 @@ TEST_CASE("database update", "[database]") {
             pdfsAfter.begin()));
     }
 
+    SECTION("updating commits in batches") {
+        fs::path from("./pdfs/good1/CrashCourse_FR.PDF");
+        fs::path to = fs::canonical("./pdfs/good1/") / fs::path("temp.pdf");
+        fs::copy(from, to);
+
+        REQUIRE_NOTHROW(db.index(dirs, Options::RECURSE_INFINITELY));
+        fs::remove(to);
+
+        IndexSettings settings;
+        settings.commitEvery = 1;
+        REQUIRE_NOTHROW(db.update(settings));
+
+        Statement s(db, "select count(*) from pdfs where file = ?1;");
+        s.bind(to.native(), 1);
+        auto it = s.begin();
+        REQUIRE(*(it.column<int>(0)) == 0);
+    }
+
     SECTION("updating after removing a pdf deletes pdf from database") {
         fs::path from("./pdfs/good1/CrashCourse_FR.PDF");
         fs::path to = fs::canonical("./pdfs/good1/") / fs::path("temp.pdf");
@@ -382,6 +867,13 @@ TEST_CASE("database query1", "[database]") {
     REQUIRE(r.at(0).page > 0);
     REQUIRE(r.at(0).pages > 0);
 
+    // Stored page count is the number of pages of the pdf.
+    Statement s(db, "select count(*) from PlainTexts T join Pdfs P"
+        " on P.id = T.pdfs_id where P.file = ?1;");
+    s.bind(r.at(0).file, 1);
+    REQUIRE(*(s.begin().column<int>(0)) == r.at(0).pages);
+    s.reset();
+
     // There's surrounding text around the match.
     REQUIRE_NOTHROW(r = db.query("utf-8", true, 1));
 
@@ -392,6 +884,415 @@ TEST_CASE("database query1", "[database]") {
     fs::remove(dbFile);
 }
 
+TEST_CASE("database query callback", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+
+    QuerySettings settings;
+    settings.verbose = true;
+    std::vector<QueryResult> found;
+    auto collect = [&](const QueryResult& r) { found.push_back(r); };
+
+    SECTION("callback gets the same results as the vector") {
+        const auto& r(db.query("unicode", settings));
+        REQUIRE_NOTHROW(db.query("unicode", settings, collect));
+
+        REQUIRE(found.size() == r.size());
+        for (size_t i = 0; i < r.size(); i++) {
+            REQUIRE(found.at(i).file == r.at(i).file);
+            REQUIRE(found.at(i).page == r.at(i).page);
+            REQUIRE(found.at(i).chunk == r.at(i).chunk);
+        }
+    }
+
+    SECTION("matches limits the calls") {
+        settings.matches = 2;
+        REQUIRE_NOTHROW(db.query("%", settings, collect));
+
+        REQUIRE(found.size() == 2);
+    }
+
+    SECTION("an exception from the callback stops the query") {
+        int calls = 0;
+        REQUIRE_THROWS_AS(db.query("%", settings, [&](const QueryResult&) {
+            calls++;
+            throw std::runtime_error("stop");
+        }), std::runtime_error);
+
+        REQUIRE(calls == 1);
+        REQUIRE(db.query("%", settings).size() > 1);
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database repeated queries", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+    db.createSubstringIndex();
+
+    // Statements are reused, also ones left before their last row.
+    QuerySettings settings;
+    settings.verbose = true;
+    const auto& all(db.query("unicode", settings));
+    settings.matches = 1;
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(db.query("unicode", settings).size() == 1);
+        settings.regex = true;
+        REQUIRE(db.query("unicod.", settings).size() == 1);
+        settings.regex = false;
+    }
+    settings.matches = 0;
+    REQUIRE(db.query("unicode", settings).size() == all.size());
+
+    // An index created by another connection is found.
+    settings.fullText = true;
+    REQUIRE_THROWS_AS(db.query("unicode", settings), DatabaseError);
+    {
+        Database other(dbFile);
+        other.createFullTextIndex();
+    }
+    REQUIRE(!db.query("unicode", settings).empty());
+    settings.fullText = false;
+
+    // No read transaction is left open.
+    DatabaseSettings writerSettings;
+    writerSettings.busyTimeout = 0;
+    Database writer(dbFile, writerSettings);
+    Statement s(writer, "delete from Pdfs;");
+    REQUIRE_NOTHROW(s.step());
+    REQUIRE(db.query("unicode", settings).empty());
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database files with matches", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+
+    QuerySettings settings;
+    settings.verbose = true;
+    std::vector<std::string> pages;
+    for (const auto& r : db.query("unicode", settings))
+        pages.push_back(r.file);
+    const std::set<std::string> expected(pages.begin(), pages.end());
+    REQUIRE(pages.size() > expected.size());
+
+    settings.filesWithMatches = true;
+    auto files = [&]() {
+        std::vector<std::string> f;
+        for (const auto& r : db.query("unicode", settings)) {
+            REQUIRE(r.chunk.empty());
+            f.push_back(r.file);
+        }
+        return f;
+    };
+
+    SECTION("every pdf once") {
+        const auto& f(files());
+        REQUIRE(f.size() == expected.size());
+        REQUIRE(std::set<std::string>(f.begin(), f.end()) == expected);
+    }
+
+    SECTION("every pdf once with the substring index") {
+        db.createSubstringIndex();
+        const auto& f(files());
+        REQUIRE(f.size() == expected.size());
+        REQUIRE(std::set<std::string>(f.begin(), f.end()) == expected);
+    }
+
+    SECTION("every pdf once with the full-text index") {
+        db.createFullTextIndex();
+        settings.fullText = true;
+        const auto& f(files());
+        REQUIRE(f.size() == expected.size());
+        REQUIRE(std::set<std::string>(f.begin(), f.end()) == expected);
+    }
+
+    SECTION("matches limits pdfs") {
+        settings.matches = 1;
+        REQUIRE(files().size() == 1);
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database sort", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+
+    for (const auto& sql : {
+            "insert into Pdfs(id, file, last_modified, pages, text_length)"
+                " values(1, 'b.pdf', 300, 2, 36), (2, 'a.pdf', 100, 1, 4),"
+                " (3, 'c.pdf', 200, 1, 12);",
+            "insert into PlainTexts(plain_text, page, pdfs_id, folded_text)"
+                " values('Word other other other', 1, 1,"
+                " 'word other other other'),"
+                " ('word WORD word', 2, 1, 'word word word'),"
+                " ('word', 1, 2, 'word'),"
+                " ('nothing here', 1, 3, 'nothing here');" }) {
+        Statement s(db, sql);
+        s.step();
+    }
+
+    QuerySettings settings;
+    settings.verbose = true;
+    auto pages = [&]() {
+        std::vector<std::pair<std::string, int>> pages;
+        for (const auto& r : db.query("word", settings))
+            pages.push_back(std::make_pair(r.file, r.page));
+        return pages;
+    };
+    auto files = [&]() {
+        settings.filesWithMatches = true;
+        std::vector<std::string> files;
+        for (const auto& r : db.query("word", settings))
+            files.push_back(r.file);
+        return files;
+    };
+    typedef std::vector<std::pair<std::string, int>> Pages;
+    typedef std::vector<std::string> Files;
+    const Pages byRelevance{ { "b.pdf", 2 }, { "a.pdf", 1 }, { "b.pdf", 1 } };
+
+    SECTION("relevance") {
+        settings.sort = "relevance";
+        // More matches, then a shorter page, is more relevant.
+        REQUIRE(pages() == byRelevance);
+        REQUIRE(db.query("word", settings).at(1).chunk == "word");
+        settings.matches = 2;
+        REQUIRE(pages() == Pages(byRelevance.begin(), byRelevance.begin() + 2));
+        settings.matches = 0;
+        REQUIRE(files() == Files({ "b.pdf", "a.pdf" }));
+        settings.matches = 1;
+        REQUIRE(files() == Files({ "b.pdf" }));
+    }
+
+    SECTION("relevance with the substring index") {
+        db.createSubstringIndex();
+        settings.sort = "relevance";
+        REQUIRE(pages() == byRelevance);
+        REQUIRE(files() == Files({ "b.pdf", "a.pdf" }));
+    }
+
+    SECTION("relevance with the full-text index") {
+        db.createFullTextIndex();
+        settings.fullText = true;
+        settings.sort = "relevance";
+        REQUIRE(pages() == byRelevance);
+        settings.matches = 1;
+        REQUIRE(pages() == Pages({ { "b.pdf", 2 } }));
+        settings.matches = 0;
+        REQUIRE(files() == Files({ "b.pdf", "a.pdf" }));
+    }
+
+    SECTION("path") {
+        settings.sort = "path";
+        const Pages expected{ { "a.pdf", 1 }, { "b.pdf", 1 }, { "b.pdf", 2 } };
+        REQUIRE(pages() == expected);
+        db.createSubstringIndex();
+        REQUIRE(pages() == expected);
+        REQUIRE(files() == Files({ "a.pdf", "b.pdf" }));
+        db.createFullTextIndex();
+        settings.fullText = true;
+        REQUIRE(files() == Files({ "a.pdf", "b.pdf" }));
+    }
+
+    SECTION("mtime") {
+        settings.sort = "mtime";
+        const Pages expected{ { "b.pdf", 1 }, { "b.pdf", 2 }, { "a.pdf", 1 } };
+        REQUIRE(pages() == expected);
+        settings.matches = 1;
+        REQUIRE(files() == Files({ "b.pdf" }));
+        db.createFullTextIndex();
+        settings.fullText = true;
+        settings.filesWithMatches = false;
+        settings.matches = 0;
+        REQUIRE(pages() == expected);
+    }
+
+    SECTION("unknown sort") {
+        settings.sort = "size";
+        REQUIRE_THROWS_AS(db.query("word", settings), std::invalid_argument);
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database regex query", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+
+    for (const auto& sql : {
+            "insert into Pdfs(id, file, last_modified, pages, text_length)"
+                " values(1, 'b.pdf', 300, 2, 31), (2, 'a.pdf', 100, 1, 10),"
+                " (3, 'c.pdf', 200, 1, 6);",
+            "insert into PlainTexts(plain_text, page, pdfs_id, folded_text)"
+                " values('CVE-2021-1 CVE-2022-9', 1, 1,"
+                " 'cve-2021-1 cve-2022-9'),"
+                " ('no id here', 2, 1, 'no id here'),"
+                " ('cve-2020-7', 1, 2, 'cve-2020-7'),"
+                " ('CVE-20', 1, 3, 'cve-20');" }) {
+        Statement s(db, sql);
+        s.step();
+    }
+
+    const std::string query("CVE-20\\d{2}-\\d+");
+    QuerySettings settings;
+    settings.regex = true;
+    settings.verbose = true;
+    settings.sort = "path";
+    typedef std::vector<std::pair<std::string, int>> Pages;
+    auto pages = [&]() {
+        Pages pages;
+        for (const auto& r : db.query(query, settings))
+            pages.push_back(std::make_pair(r.file, r.page));
+        return pages;
+    };
+    const Pages expected{ { "a.pdf", 1 }, { "b.pdf", 1 } };
+
+    SECTION("pages") {
+        REQUIRE(pages() == expected);
+        settings.matches = 1;
+        REQUIRE(pages() == Pages({ { "a.pdf", 1 } }));
+    }
+
+    SECTION("pages with the substring index") {
+        db.createSubstringIndex();
+        REQUIRE(pages() == expected);
+        settings.sort = "";
+        REQUIRE(pages().size() == expected.size());
+    }
+
+    SECTION("chunk") {
+        settings.wordsBefore = 0;
+        settings.wordsAfter = 0;
+        const auto& results(db.query(query, settings));
+        REQUIRE(results.at(1).chunk == "CVE-2021-1");
+    }
+
+    SECTION("files") {
+        settings.filesWithMatches = true;
+        settings.sort = "mtime";
+        std::vector<std::string> files;
+        for (const auto& r : db.query("\\d{4}-\\d", settings))
+            files.push_back(r.file);
+        REQUIRE(files == std::vector<std::string>({ "b.pdf", "a.pdf" }));
+    }
+
+    SECTION("relevance") {
+        settings.sort = "relevance";
+        // More matches on a page of average length is more relevant.
+        REQUIRE(pages() == Pages({ { "b.pdf", 1 }, { "a.pdf", 1 } }));
+    }
+
+    SECTION("invalid") {
+        REQUIRE_THROWS_AS(db.query("(", settings), std::invalid_argument);
+        settings.fullText = true;
+        REQUIRE_THROWS_AS(db.query("a", settings), std::invalid_argument);
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database migration", "[database]") {
+    std::string dbFile("./testdb");
+    fs::remove(dbFile);
+    Database db(dbFile);
+
+    // Schema before Pdfs.pages and PlainTexts.folded_text, with a substring
+    // index of the text.
+    for (const auto& sql : {
+            "create table Pdfs(id integer primary key asc,"
+                " file text unique not null, last_modified int not null);",
+            "create table PlainTexts(plain_text text default '',"
+                " page int not null, pdfs_id integer not null"
+                " references Pdfs(id) on delete cascade);",
+            "insert into Pdfs values(1, 'a.pdf', 0), (2, 'b.pdf', 0);",
+            "insert into PlainTexts values('a1', 1, 1), ('a2', 2, 1),"
+                " ('a3', 3, 1), ('\u00c4RGER \ufb01le', 1, 2);",
+            "create virtual table PageTrigrams using fts5(plain_text,"
+                " content='PlainTexts', tokenize='trigram');",
+            "insert into PageTrigrams(PageTrigrams) values('rebuild');" }) {
+        Statement s(db, sql);
+        s.step();
+    }
+
+    std::vector<QueryResult> r;
+    REQUIRE_NOTHROW(r = db.query("a", true, Options::UNLIMITED_MATCHES));
+    REQUIRE(r.size() == 3);
+    REQUIRE(r.at(0).pages == 3);
+
+    SECTION("page counts are filled in") {
+        Statement s(db, "select pages from Pdfs order by id;");
+        std::vector<int> pages;
+        for (auto it = s.begin(); it != s.end(); it++)
+            pages.push_back(*(it.column<int>(0)));
+
+        REQUIRE(pages == std::vector<int>({ 3, 1 }));
+    }
+
+    SECTION("text lengths are filled in") {
+        Statement s(db, "select text_length from Pdfs order by id;");
+        std::vector<int> lengths;
+        for (auto it = s.begin(); it != s.end(); it++)
+            lengths.push_back(*(it.column<int>(0)));
+
+        REQUIRE(lengths == std::vector<int>({ 6, 11 }));
+    }
+
+    SECTION("folded texts are filled in and indexed") {
+        REQUIRE(db.substringIndexCreated());
+        for (const auto& q : { "file", u8"\u00e4rger", u8"\u00c4RG" }) {
+            REQUIRE_NOTHROW(r = db.query(q, true, Options::UNLIMITED_MATCHES));
+            REQUIRE(r.size() == 1);
+            REQUIRE(r.at(0).file == "b.pdf");
+        }
+        // The text has the query with ASCII case folding.
+        REQUIRE(r.at(0).chunk == u8"\u00c4RGER \ufb01le");
+        REQUIRE_NOTHROW(r = db.query(u8"\u00e4", true, 1));
+        REQUIRE(r.at(0).chunk == u8"\u00e4rger file");
+    }
+
+    SECTION("database is migrated once") {
+        Statement s(db, "PRAGMA user_version;");
+        REQUIRE(*(s.begin().column<int>(0)) == 3);
+        s.reset();
+
+        REQUIRE_NOTHROW(db.query("b", true, Options::UNLIMITED_MATCHES));
+    }
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("database fold function", "[database]") {
+    std::string dbFile("./testdb");
+    Database db(dbFile);
+
+    Statement s(db, u8"select fold('\u00d6\u00c4\u00c5 \ufb01'), fold(null);");
+    auto it = s.begin();
+    REQUIRE(*(it.column<std::string>(0)) == u8"\u00f6\u00e4\u00e5 fi");
+    REQUIRE(!it.column<std::string>(1));
+    s.reset();
+
+    fs::remove(dbFile);
+}
+
 TEST_CASE("database constraints", "[database]") {
     std::string dbFile("./testdb");
     fs::remove(dbFile);
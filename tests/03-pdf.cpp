@@ -1,4 +1,7 @@
+#include <fstream>
+#include <iterator>
 #include <string>
+#include <vector>
 #include "pdf.h"
 #include "catch.hpp"
 
@@ -10,6 +13,37 @@ TEST_CASE("load not a pdf", "[pdf]") {
     REQUIRE_THROWS_AS(Pdfsearch::Pdf p("notapdf"), std::runtime_error);
 }
 
+TEST_CASE("load mapped pdf", "[pdf]") {
+    const std::string file("pdfs/good1/good2/unicodeexample.pdf");
+    Pdfsearch::Pdf read(file);
+    Pdfsearch::Pdf mapped(file, true);
+
+    REQUIRE(mapped.getFile() == file);
+    REQUIRE(mapped.numberOfPages() == read.numberOfPages());
+    for (int i = 0; i < read.numberOfPages(); i++)
+        REQUIRE(*mapped.getPage(i) == *read.getPage(i));
+
+    REQUIRE_THROWS_AS(Pdfsearch::Pdf p("notapdf", true), std::runtime_error);
+    REQUIRE_THROWS_AS(Pdfsearch::Pdf p("pdfs/bad1/b1.pdf", true),
+        std::runtime_error);
+}
+
+TEST_CASE("load pdf from memory", "[pdf]") {
+    const std::string file("pdfs/good1/good2/unicodeexample.pdf");
+    std::ifstream in(file, std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(in)),
+        std::istreambuf_iterator<char>());
+    Pdfsearch::Pdf read(file);
+    Pdfsearch::Pdf loaded(data, "memory");
+
+    REQUIRE(loaded.getFile() == "memory");
+    REQUIRE(loaded.numberOfPages() == read.numberOfPages());
+    REQUIRE(*loaded.getPage(0) == *read.getPage(0));
+
+    REQUIRE_THROWS_AS(Pdfsearch::Pdf p(std::vector<char>(10, 'a'), "memory"),
+        std::runtime_error);
+}
+
 TEST_CASE("pages", "[pdf]") {
     Pdfsearch::Pdf p("pdfs/good1/good2/unicodeexample.pdf");
 
@@ -22,9 +56,19 @@ TEST_CASE("pages", "[pdf]") {
         REQUIRE(page->find("Unicode") != std::string::npos);
     }
 
+    SECTION("a page is read into a buffer") {
+        std::string page("old text");
+        for (int i = 0; i < p.numberOfPages(); i++) {
+            p.getPage(i, page);
+            REQUIRE(page == *p.getPage(i));
+        }
+    }
+
     SECTION("getting a not existing page throws") {
         REQUIRE_THROWS_AS(p.getPage(6), std::invalid_argument);
         REQUIRE_THROWS_AS(p.getPage(-1), std::invalid_argument);
+        std::string page;
+        REQUIRE_THROWS_AS(p.getPage(6, page), std::invalid_argument);
     }
 }
 
@@ -1,5 +1,6 @@
 #include <string>
 #include <boost/filesystem.hpp>
+#include <boost/utility/string_view.hpp>
 #include "catch.hpp"
 #include "statement.h"
 #include "database.h"
@@ -41,6 +42,40 @@ TEST_CASE("statement bind", "[statement]") {
     fs::remove(dbFile);
 }
 
+TEST_CASE("statement bind view", "[statement]") {
+    std::string dbFile("./testdb");
+    Database db(dbFile);
+    db.createDatabase();
+
+    Statement s(db, "select ?1, typeof(?1), ?2, typeof(?2), length(?2);",
+        SQLITE_PREPARE_PERSISTENT);
+    const std::string text("a\0b", 3);
+    const std::string bytes("\0\xff", 2);
+    for (int i = 0; i < 2; i++) {
+        s.bind(boost::string_view(text), 1);
+        s.bind(Blob{ bytes }, 2);
+        auto it = s.begin();
+        REQUIRE(*it.value<boost::string_view>(0) == text);
+        REQUIRE(*it.value<boost::string_view>(1) == "text");
+        REQUIRE(*it.blob(2) == bytes);
+        REQUIRE(*it.value<boost::string_view>(3) == "blob");
+        REQUIRE(*it.value<int>(4) == 2);
+        s.reset();
+    }
+
+    // Empty values aren't NULL.
+    s.bind(boost::string_view(), 1);
+    s.bind(Blob{ boost::string_view() }, 2);
+    auto it = s.begin();
+    REQUIRE(*it.value<boost::string_view>(1) == "text");
+    REQUIRE(*it.value<boost::string_view>(3) == "blob");
+    s.reset();
+
+    REQUIRE_THROWS_AS(s.bind(boost::string_view(text), 3), DatabaseError);
+
+    fs::remove(dbFile);
+}
+
 TEST_CASE("statement step", "[statement]") {
     std::string dbFile("./testdb");
     Database db(dbFile);
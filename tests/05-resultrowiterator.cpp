@@ -109,7 +109,7 @@ TEST_CASE("resultrowiterator column ok", "[resultrowiterator]") {
     std::vector<std::tuple<std::string, int>> output;
     for (auto it = s.begin(); it != s.end(); ++it) {
         std::string f;
-        int lm;
+        int lm = 0;
         
         REQUIRE_NOTHROW(f = *(it.column<std::string>(0)));
         REQUIRE_NOTHROW(lm = *(it.column<int>(1)));
@@ -165,3 +165,33 @@ TEST_CASE("resultrowiterator column fail", "[resultrowiterator]") {
 
     fs::remove(dbFile);
 }
+
+TEST_CASE("resultrowiterator value", "[resultrowiterator]") {
+    std::string dbFile("./testdb");
+    Database db(dbFile);
+    db.createDatabase();
+
+    Statement s(db, "select 1, 5000000000, 0.5, 'a' || char(0) || 'b', null,"
+        " x'00ff', x'';");
+    auto it = s.begin();
+    REQUIRE(*it.value<int>(0) == 1);
+    // Not truncated to int.
+    REQUIRE(*it.value<sqlite3_int64>(1) == 5000000000LL);
+    REQUIRE(*(it.column<sqlite3_int64>(1)) == 5000000000LL);
+    REQUIRE(*it.value<double>(2) == 0.5);
+    REQUIRE(*it.value<boost::string_view>(3) ==
+        boost::string_view("a\0b", 3));
+    REQUIRE(*(it.column<std::string>(3)) == std::string("a\0b", 3));
+    REQUIRE(!it.value<int>(4));
+    REQUIRE(!it.value<boost::string_view>(4));
+    REQUIRE(!it.blob(4));
+    REQUIRE(*it.blob(5) == boost::string_view("\0\xff", 2));
+    REQUIRE(it.blob(6)->empty());
+
+    REQUIRE_THROWS_AS(it.value<boost::string_view>(0), DatabaseError);
+    REQUIRE_THROWS_AS(it.value<int>(3), DatabaseError);
+    REQUIRE_THROWS_AS(it.blob(3), DatabaseError);
+    REQUIRE_THROWS_AS(it.value<int>(7), DatabaseError);
+
+    fs::remove(dbFile);
+}
@@ -0,0 +1,91 @@
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include "catch.hpp"
+#include "boundedqueue.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("boundedqueue push and pop", "[boundedqueue]") {
+    BoundedQueue<std::string> q(2);
+
+    REQUIRE(q.push("a"));
+    REQUIRE(q.push("b"));
+
+    std::string s;
+    REQUIRE(q.pop(s));
+    REQUIRE(s == "a");
+    REQUIRE(q.pop(s));
+    REQUIRE(s == "b");
+}
+
+TEST_CASE("boundedqueue close", "[boundedqueue]") {
+    BoundedQueue<int> q(2);
+    q.push(1);
+    q.close();
+
+    // Can't push to a closed queue.
+    REQUIRE(!q.push(2));
+
+    // Remaining items can be popped.
+    int i = 0;
+    REQUIRE(q.pop(i));
+    REQUIRE(i == 1);
+    REQUIRE(!q.pop(i));
+}
+
+TEST_CASE("boundedqueue abort", "[boundedqueue]") {
+    BoundedQueue<int> q(2);
+    q.push(1);
+    q.abort();
+
+    int i = 0;
+    REQUIRE(!q.pop(i));
+    REQUIRE(!q.push(2));
+}
+
+TEST_CASE("boundedqueue pop with timeout", "[boundedqueue]") {
+    BoundedQueue<int> q(2);
+    int i = 0;
+
+    // Times out on an empty open queue.
+    REQUIRE(!q.pop(i, std::chrono::milliseconds(1)));
+    REQUIRE(!q.isDrained());
+
+    q.push(1);
+    REQUIRE(q.pop(i, std::chrono::milliseconds(1)));
+    REQUIRE(i == 1);
+
+    q.close();
+    REQUIRE(!q.pop(i, std::chrono::milliseconds(1)));
+    REQUIRE(q.isDrained());
+}
+
+TEST_CASE("boundedqueue producers and consumers", "[boundedqueue]") {
+    const int PRODUCERS = 4;
+    const int ITEMS = 1000;
+    BoundedQueue<int> q(3);
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < PRODUCERS; i++) {
+        producers.emplace_back([&q]() {
+            for (int j = 1; j <= ITEMS; j++)
+                q.push(j);
+        });
+    }
+
+    long sum = 0;
+    std::thread consumer([&]() {
+        int i;
+        while (q.pop(i))
+            sum += i;
+    });
+
+    for (auto& p : producers)
+        p.join();
+    q.close();
+    consumer.join();
+
+    REQUIRE(sum == PRODUCERS * (ITEMS * (ITEMS + 1L) / 2));
+}
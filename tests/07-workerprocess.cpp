@@ -0,0 +1,74 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "catch.hpp"
+#include "pdf.h"
+#include "workerprocess.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("workerprocess extract", "[workerprocess]") {
+    WorkerProcess worker(0);
+    std::vector<std::string> pages;
+
+    REQUIRE_NOTHROW(pages = worker.extract("pdfs/good1/good2/unicodeexample.pdf"));
+
+    Pdf doc("pdfs/good1/good2/unicodeexample.pdf");
+    REQUIRE(pages.size() == static_cast<size_t>(doc.numberOfPages()));
+    REQUIRE(pages.at(0) == *doc.getPage(0));
+    REQUIRE(worker.getDocuments() == 1);
+    REQUIRE(worker.isRunning());
+}
+
+TEST_CASE("workerprocess extract fail", "[workerprocess]") {
+    WorkerProcess worker(0);
+
+    REQUIRE_THROWS_AS(worker.extract("notapdf"), std::runtime_error);
+
+    // A pdf which can't be loaded doesn't stop the worker.
+    REQUIRE(worker.isRunning());
+    REQUIRE_NOTHROW(worker.extract("pdfs/good1/CrashCourse_FR.PDF"));
+    REQUIRE(worker.getDocuments() == 2);
+}
+
+TEST_CASE("workerprocess timeout", "[workerprocess]") {
+    WorkerProcess worker(10);
+
+    REQUIRE_NOTHROW(worker.extract("pdfs/good1/CrashCourse_FR.PDF"));
+    REQUIRE(worker.isRunning());
+}
+
+TEST_CASE("workerprocess mmap", "[workerprocess]") {
+    WorkerProcess worker(0, true);
+
+    REQUIRE(worker.extract("pdfs/good1/good2/unicodeexample.pdf").size() > 0);
+    REQUIRE(worker.isRunning());
+}
+
+TEST_CASE("workerprocess threads", "[workerprocess]") {
+    const int THREADS = 4;
+    const int WORKERS = 5;
+    std::atomic<int> extracted(0);
+
+    // Workers are started while the other threads run.
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; i++) {
+        threads.emplace_back([&extracted]() {
+            for (int j = 0; j < WORKERS; j++) {
+                try {
+                    WorkerProcess worker(10);
+                    auto pages(worker.extract("pdfs/good1/CrashCourse_FR.PDF"));
+                    if (!pages.empty())
+                        extracted++;
+                }
+                catch (const std::exception&) {
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    REQUIRE(extracted == THREADS * WORKERS);
+}
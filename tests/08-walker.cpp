@@ -0,0 +1,91 @@
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <boost/filesystem.hpp>
+#include "catch.hpp"
+#include "options.h"
+#include "walker.h"
+
+namespace fs = boost::filesystem;
+using namespace Pdfsearch;
+
+static std::map<std::string, std::time_t>
+findPdfs(const std::string& name, const std::string& dir, int depth,
+    int threads = 1);
+
+TEST_CASE("walker create", "[walker]") {
+    REQUIRE_NOTHROW(Walker::create("boost"));
+    REQUIRE_NOTHROW(Walker::create("getdents"));
+    REQUIRE_NOTHROW(Walker::create("getdents", 4));
+    REQUIRE_THROWS_AS(Walker::create("find"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Walker::create("boost", 4), std::invalid_argument);
+    REQUIRE_THROWS_AS(Walker::create("getdents", 0), std::invalid_argument);
+}
+
+TEST_CASE("walker find pdfs", "[walker]") {
+    const auto& pdf = fs::canonical("./pdfs/good1/good2/unicodeexample.pdf");
+
+    for (const auto& name : { "boost", "getdents" }) {
+        auto pdfs(findPdfs(name, "./pdfs", Options::RECURSE_INFINITELY));
+
+        REQUIRE(pdfs.size() == 5);
+        REQUIRE(pdfs.count(pdf.native()) == 1);
+        REQUIRE(pdfs.at(pdf.native()) == fs::last_write_time(pdf));
+    }
+}
+
+TEST_CASE("walker walkers find the same pdfs", "[walker]") {
+    for (int depth : { 0, 1, 2, 3, int(Options::RECURSE_INFINITELY) }) {
+        REQUIRE(findPdfs("boost", "./pdfs", depth) ==
+            findPdfs("getdents", "./pdfs", depth));
+        REQUIRE(findPdfs("boost", "./pdfs", depth) ==
+            findPdfs("getdents", "./pdfs", depth, 4));
+    }
+}
+
+TEST_CASE("walker many threads", "[walker]") {
+    // More threads than directories, most threads only look for work.
+    for (int threads : { 2, 16 }) {
+        REQUIRE(findPdfs("getdents", "./pdfs", Options::RECURSE_INFINITELY,
+            threads).size() == 5);
+        REQUIRE(findPdfs("getdents", "./pdfs", 1, threads).size() == 3);
+    }
+    REQUIRE_THROWS_AS(findPdfs("getdents", "./no such directory", 0, 4),
+        std::runtime_error);
+}
+
+TEST_CASE("walker recursion", "[walker]") {
+    for (const auto& name : { "boost", "getdents" }) {
+        // Don't recurse into directories.
+        REQUIRE(findPdfs(name, "./pdfs", 0).empty());
+        // Only pdfs in pdfs/bad1 and pdfs/good1.
+        REQUIRE(findPdfs(name, "./pdfs", 1).size() == 3);
+        REQUIRE(findPdfs(name, "./pdfs", 2).size() == 4);
+    }
+}
+
+TEST_CASE("walker directory not found", "[walker]") {
+    for (const auto& name : { "boost", "getdents" }) {
+        REQUIRE_THROWS_AS(findPdfs(name, "./no such directory", 0),
+            std::runtime_error);
+    }
+}
+
+/* Helper functions */
+
+static std::map<std::string, std::time_t>
+findPdfs(const std::string& name, const std::string& dir, int depth,
+        int threads) {
+    std::map<std::string, std::time_t> pdfs;
+    std::mutex mutex;
+    Walker::create(name, threads)->walk(dir, depth,
+        [&](const std::string& file, std::time_t lastModified) {
+            std::lock_guard<std::mutex> lock(mutex);
+            pdfs[file] = lastModified;
+        },
+        [](const std::exception&) {
+        });
+
+    return pdfs;
+}
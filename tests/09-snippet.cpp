@@ -0,0 +1,80 @@
+#include <string>
+#include "catch.hpp"
+#include "snippet.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("snippet words around match", "[snippet]") {
+    const std::string text("one two three four five six seven");
+
+    REQUIRE(Snippet("four", 1, 1).find(text) == "three four five");
+    REQUIRE(Snippet("four", 0, 0).find(text) == "four");
+    REQUIRE(Snippet("four", 5, 5).find(text) == text);
+    REQUIRE(Snippet("one", 2, 1).find(text) == "one two");
+    REQUIRE(Snippet("seven", 1, 2).find(text) == "six seven");
+
+    // A word containing the match is included whole.
+    REQUIRE(Snippet("ou", 0, 0).find(text) == "four");
+    REQUIRE(Snippet("r fi", 0, 0).find(text) == "four five");
+}
+
+TEST_CASE("snippet whitespace", "[snippet]") {
+    REQUIRE(Snippet("b", 1, 1).find("  a\n\tb  c\r\n") == "a b c");
+}
+
+TEST_CASE("snippet case", "[snippet]") {
+    // Like LIKE, only ASCII letters are case-insensitive.
+    REQUIRE(Snippet("wOrLd", 0, 0).find("Hello WORLD") == "WORLD");
+    REQUIRE(Snippet(u8"Ä", 0, 0).find(u8"ä").empty());
+    REQUIRE(Snippet(u8"ä", 0, 0).find(u8"xä") == u8"xä");
+    REQUIRE(Snippet("@", 0, 0).find("`").empty());
+}
+
+TEST_CASE("snippet wildcards", "[snippet]") {
+    REQUIRE(Snippet("c_t", 0, 0).find("ct cot") == "cot");
+    REQUIRE(Snippet("c_t", 0, 0).find(u8"ct cät") == u8"cät");
+    REQUIRE(Snippet("a%c", 0, 0).find("c ab bbc") == "ab bbc");
+    REQUIRE(Snippet("_b", 0, 0).find("b ab") == "ab");
+    REQUIRE(Snippet("__", 0, 0).find(u8"ä").empty());
+    REQUIRE(Snippet("__", 0, 0).find(u8"äb") == u8"äb");
+    REQUIRE(Snippet("a%c", 0, 0).find("ca").empty());
+
+    // Only wildcards match at the beginning.
+    REQUIRE(Snippet("%", 0, 1).find("alpha beta gamma") == "alpha beta");
+    REQUIRE(Snippet("", 0, 0).find("alpha beta") == "alpha");
+}
+
+TEST_CASE("snippet regex characters", "[snippet]") {
+    REQUIRE(Snippet("(a+", 0, 0).find("x (a+ y") == "(a+");
+    REQUIRE(Snippet("a.c", 0, 0).find("abc a.c") == "a.c");
+}
+
+TEST_CASE("snippet match", "[snippet]") {
+    // Longer than the vector width, with false candidates.
+    std::string text(100, 'x');
+    text += "XaXbXab";
+    text += std::string(20, 'y');
+
+    size_t begin, end;
+    REQUIRE(Snippet("xab", 0, 0).match(text, begin, end));
+    REQUIRE(begin == 104);
+    REQUIRE(end == 107);
+
+    REQUIRE(Snippet("_ab", 0, 0).match(text, begin, end));
+    REQUIRE(begin == 104);
+
+    REQUIRE(Snippet("y%y", 0, 0).match(text, begin, end));
+    REQUIRE(begin == 107);
+    REQUIRE(end == 109);
+
+    REQUIRE(!Snippet("xaby", 0, 0).match(text.substr(0, 107), begin, end));
+    REQUIRE(!Snippet("xx", 0, 0).match("x", begin, end));
+}
+
+TEST_CASE("snippet count", "[snippet]") {
+    REQUIRE(Snippet("ab", 0, 0).count("ab xab AB a b") == 3);
+    REQUIRE(Snippet("aa", 0, 0).count("aaaaa") == 2);
+    REQUIRE(Snippet("a%b", 0, 0).count("a b a b a") == 2);
+    REQUIRE(Snippet("x", 0, 0).count("abc") == 0);
+    REQUIRE(Snippet("%", 0, 0).count("abc") == 1);
+}
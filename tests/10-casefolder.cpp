@@ -0,0 +1,34 @@
+#include <string>
+#include "catch.hpp"
+#include "casefolder.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("casefolder case", "[casefolder]") {
+    REQUIRE(CaseFolder::fold("ABC abc") == "abc abc");
+    REQUIRE(CaseFolder::fold(u8"ÖÄÅ öäå") == u8"öäå öäå");
+    REQUIRE(CaseFolder::fold(u8"ΣΊΣΥΦΟΣ") == u8"σίσυφοσ");
+    REQUIRE(CaseFolder::fold(u8"Straße") == "strasse");
+}
+
+TEST_CASE("casefolder compatibility characters", "[casefolder]") {
+    // Ligatures, full-width letters and soft hyphens.
+    REQUIRE(CaseFolder::fold(u8"ﬁnd eﬀect") == "find effect");
+    REQUIRE(CaseFolder::fold(u8"Ａｂｃ") == "abc");
+    REQUIRE(CaseFolder::fold(u8"hy­phen") == "hyphen");
+}
+
+TEST_CASE("casefolder hyphenated words", "[casefolder]") {
+    REQUIRE(CaseFolder::fold("exam-\nple") == "example");
+    REQUIRE(CaseFolder::fold("Exam- \r\n  ple text") == "example text");
+
+    // Not at the end of a line, or not after a word.
+    REQUIRE(CaseFolder::fold("well-known") == "well-known");
+    REQUIRE(CaseFolder::fold("a -\nb") == "a -\nb");
+    REQUIRE(CaseFolder::fold("a--\nb") == "a--\nb");
+    REQUIRE(CaseFolder::fold("end-\n") == "end-\n");
+}
+
+TEST_CASE("casefolder invalid UTF-8", "[casefolder]") {
+    REQUIRE(CaseFolder::fold("A\xff" "B") == "a\xff" "b");
+}
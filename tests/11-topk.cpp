@@ -0,0 +1,64 @@
+#include <string>
+#include <utility>
+#include <vector>
+#include "catch.hpp"
+#include "topk.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("topk keeps the greatest", "[topk]") {
+    TopK<int> top(3);
+    for (int i : { 5, 1, 9, 3, 7, 2, 8 })
+        top.push(i);
+
+    REQUIRE(top.size() == 3);
+    REQUIRE(top.take() == std::vector<int>({ 9, 8, 7 }));
+    REQUIRE(top.size() == 0);
+}
+
+TEST_CASE("topk fewer items than capacity", "[topk]") {
+    TopK<int> top(10);
+    top.push(1);
+    top.push(2);
+
+    REQUIRE(top.take() == std::vector<int>({ 2, 1 }));
+}
+
+TEST_CASE("topk unlimited", "[topk]") {
+    TopK<int> top(0);
+    for (int i = 0; i < 100; i++)
+        top.push(i % 10);
+
+    REQUIRE(top.size() == 100);
+    const auto items(top.take());
+    REQUIRE(items.front() == 9);
+    REQUIRE(items.back() == 0);
+}
+
+TEST_CASE("topk admits", "[topk]") {
+    TopK<int> top(2);
+    REQUIRE(top.admits(1));
+    top.push(5);
+    top.push(6);
+
+    REQUIRE(!top.admits(4));
+    // Equal to the least isn't greater.
+    REQUIRE(!top.admits(5));
+    REQUIRE(top.admits(7));
+}
+
+TEST_CASE("topk compare", "[topk]") {
+    typedef std::pair<int, std::string> Item;
+    auto shorter = [](const Item& a, const Item& b) {
+        return a.second.size() > b.second.size();
+    };
+    TopK<Item, decltype(shorter)> top(2, shorter);
+    top.push(Item(1, "ccc"));
+    top.push(Item(2, "a"));
+    top.push(Item(3, "bb"));
+
+    const auto items(top.take());
+    REQUIRE(items.size() == 2);
+    REQUIRE(items[0].first == 2);
+    REQUIRE(items[1].first == 3);
+}
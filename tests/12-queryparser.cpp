@@ -0,0 +1,58 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "queryparser.h"
+
+using namespace Pdfsearch;
+
+TEST_CASE("queryparser words", "[queryparser]") {
+    REQUIRE(QueryParser::toMatch("kernel") == "\"kernel\"");
+    // Terms next to each other must all match.
+    REQUIRE(QueryParser::toMatch(" kernel\tcfs ") ==
+        "\"kernel\" AND \"cfs\"");
+    REQUIRE(QueryParser::toMatch("") == "");
+    REQUIRE(QueryParser::toMatch("  ") == "");
+}
+
+TEST_CASE("queryparser operators", "[queryparser]") {
+    REQUIRE(QueryParser::toMatch("kernel AND (scheduler OR cfs) NOT rt") ==
+        "\"kernel\" AND (\"scheduler\" OR \"cfs\") NOT \"rt\"");
+    REQUIRE(QueryParser::toMatch("a OR b c") == "\"a\" OR \"b\" AND \"c\"");
+    REQUIRE(QueryParser::toMatch("a NOT b NOT c") ==
+        "\"a\" NOT \"b\" NOT \"c\"");
+    REQUIRE(QueryParser::toMatch("((a))") == "((\"a\"))");
+    // Only upper case words are operators.
+    REQUIRE(QueryParser::toMatch("a and b") ==
+        "\"a\" AND \"and\" AND \"b\"");
+}
+
+TEST_CASE("queryparser phrases", "[queryparser]") {
+    REQUIRE(QueryParser::toMatch("\"exact phrase\" OR(word)") ==
+        "\"exact phrase\" OR (\"word\")");
+    REQUIRE(QueryParser::toMatch("\"AND\"") == "\"AND\"");
+    // FTS5 syntax is plain text.
+    REQUIRE(QueryParser::toMatch("a* ^b c:d") ==
+        "\"a*\" AND \"^b\" AND \"c:d\"");
+}
+
+TEST_CASE("queryparser expand", "[queryparser]") {
+    auto expand = [](const std::string& word) {
+        if (word == "kernal")
+            return std::vector<std::string>({ "kernel", "kernal" });
+        else if (word == "cfs")
+            return std::vector<std::string>({ "cfq" });
+        return std::vector<std::string>();
+    };
+    REQUIRE(QueryParser::toMatch("kernal NOT cfs rt", expand) ==
+        "(\"kernel\" OR \"kernal\") NOT \"cfq\" AND \"rt\"");
+    // Phrases aren't expanded.
+    REQUIRE(QueryParser::toMatch("\"kernal\"", expand) == "\"kernal\"");
+}
+
+TEST_CASE("queryparser invalid", "[queryparser]") {
+    for (const auto& q : { "\"unclosed", "(a", "a)", "()", "AND a", "a OR",
+            "NOT a", "a NOT", "a AND OR b" }) {
+        REQUIRE_THROWS_AS(QueryParser::toMatch(q), std::invalid_argument);
+    }
+}
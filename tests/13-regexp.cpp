@@ -0,0 +1,107 @@
+#include <stdexcept>
+#include <string>
+#include "catch.hpp"
+#include "regexp.h"
+
+using namespace Pdfsearch;
+
+static std::string
+find(const std::string& pattern, const std::string& text) {
+    size_t begin, end;
+    if (!Regexp(pattern).match(text, 0, begin, end))
+        return "no match";
+
+    return text.substr(begin, end - begin);
+}
+
+TEST_CASE("regexp literals", "[regexp]") {
+    REQUIRE(find("qauf", "xx qauf yy") == "qauf");
+    REQUIRE(find("qauf", "xx QAUF yy") == "QAUF");
+    REQUIRE(find("QAUF", "xx qauf yy") == "qauf");
+    REQUIRE(find("qauf", "xx qau yy") == "no match");
+    REQUIRE(find("a\\.b\\*", "axb a.b*") == "a.b*");
+    REQUIRE(find("a{,3}", "a{,3}") == "a{,3}");
+    // Non-ASCII characters are folded like the text of a page.
+    REQUIRE(find("ÄBC", "äbc") == "äbc");
+    REQUIRE(find("Straße", "strasse") == "strasse");
+}
+
+TEST_CASE("regexp classes and anchors", "[regexp]") {
+    REQUIRE(find("qauf[a-z]+", "xx QAUFbar yy") == "QAUFbar");
+    REQUIRE(find("[^a-c]+", "abcxyz") == "xyz");
+    REQUIRE(find("[]a]+", "x]a]") == "]a]");
+    REQUIRE(find("\\d+\\s\\w+", "x 42 apples") == "42 apples");
+    REQUIRE(find("[\\d.]+", "v1.25") == "1.25");
+    REQUIRE(find("a.c", "a\nc abc") == "abc");
+    REQUIRE(find("^bar$", "foo\nbar\nbaz") == "bar");
+    REQUIRE(find("\\bfoo\\b", "foobar foo") == "foo");
+    REQUIRE(find("\\Boo\\B", "oo foo fool") == "oo");
+    // A class matches the folded text in any case.
+    REQUIRE(find("[À-Ö]rger", "ärger") == "ärger");
+    REQUIRE(find("[à-ö]rger", "ÄRGER") == "ÄRGER");
+    REQUIRE(find("[^À-Ö]rger", "ärger") == "no match");
+}
+
+TEST_CASE("regexp repetition and alternation", "[regexp]") {
+    // The leftmost match, and of the matches there the one a backtracking
+    // engine would find.
+    REQUIRE(find("a|ab", "ab") == "a");
+    REQUIRE(find("(a|ab)(c|bcd)", "abcd") == "abcd");
+    REQUIRE(find("colou?r", "the colour") == "colour");
+    REQUIRE(find("a+?", "aaa") == "a");
+    REQUIRE(find("a*?b", "aaab") == "aaab");
+    REQUIRE(find("<.+>", "<a><b>") == "<a><b>");
+    REQUIRE(find("<.+?>", "<a><b>") == "<a>");
+    REQUIRE(find("[0-9]{2,3}", "a1234") == "123");
+    REQUIRE(find("x{2}", "x xx") == "xx");
+    REQUIRE(find("(?:ab){2,}", "ab ababab") == "ababab");
+}
+
+TEST_CASE("regexp linear time", "[regexp]") {
+    // Takes exponential time with a backtracking engine.
+    const std::string text(10000, 'a');
+    size_t begin, end;
+    REQUIRE(!Regexp("(a*)*b").match(text, 0, begin, end));
+    REQUIRE(!Regexp("(a|a)+b").match(text, 0, begin, end));
+}
+
+TEST_CASE("regexp count", "[regexp]") {
+    REQUIRE(Regexp("colou?r").count("color colour colr") == 2);
+    REQUIRE(Regexp("a+").count("aa b aaa") == 2);
+    REQUIRE(Regexp("x").count("abc") == 0);
+    REQUIRE(Regexp("x*").count("abc") == 1);
+}
+
+TEST_CASE("regexp trigram query", "[regexp]") {
+    REQUIRE(Regexp("qauf[a-z]+").getTrigramQuery() == "\"qauf\"");
+    REQUIRE(Regexp("abc.*xyz").getTrigramQuery() == "\"abc\" AND \"xyz\"");
+    REQUIRE(Regexp("colou?r").getTrigramQuery() ==
+        "\"color\" OR \"colour\"");
+    REQUIRE(Regexp("(abc|def)ghi").getTrigramQuery() ==
+        "\"abcghi\" OR \"defghi\"");
+    REQUIRE(Regexp("(abc.*|xyz)").getTrigramQuery() == "\"abc\" OR \"xyz\"");
+    REQUIRE(Regexp("QA\"UF").getTrigramQuery() == "\"qa\"\"uf\"");
+    // Strings shorter than a trigram can be anywhere.
+    REQUIRE(Regexp("ab.*xyz").getTrigramQuery() == "\"xyz\"");
+    REQUIRE(Regexp("a|xyz").getTrigramQuery().empty());
+    REQUIRE(Regexp("(xyz)*").getTrigramQuery().empty());
+    REQUIRE(Regexp("\\d+").getTrigramQuery().empty());
+    REQUIRE(Regexp("[Ä-Ç]rger").getTrigramQuery().find("\"ärger\"") !=
+        std::string::npos);
+}
+
+TEST_CASE("regexp errors", "[regexp]") {
+    REQUIRE_THROWS_AS(Regexp("(a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("a)"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("*a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("a|+"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("[a"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("[z-a]"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("\\q"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("a\\"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("a{2000}"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("a{3,2}"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("(?=a)"), std::invalid_argument);
+    REQUIRE_THROWS_AS(Regexp("(a{1000}){1000}"), std::invalid_argument);
+    REQUIRE_NOTHROW(Regexp(""));
+}
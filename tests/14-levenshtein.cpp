@@ -0,0 +1,56 @@
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "levenshtein.h"
+
+using namespace Pdfsearch;
+
+static bool
+match(const LevenshteinAutomaton& automaton, const std::string& term) {
+    size_t deadPrefix;
+    return automaton.match(term, deadPrefix);
+}
+
+TEST_CASE("levenshtein match", "[levenshtein]") {
+    const LevenshteinAutomaton automaton("kernel", 1);
+    REQUIRE(match(automaton, "kernel"));
+    REQUIRE(match(automaton, "kernal"));
+    REQUIRE(match(automaton, "kerne"));
+    REQUIRE(match(automaton, "kernels"));
+    REQUIRE(match(automaton, "krnel"));
+    REQUIRE(!match(automaton, "kernals"));
+    REQUIRE(!match(automaton, "colonel"));
+    REQUIRE(!match(automaton, ""));
+
+    REQUIRE(match(LevenshteinAutomaton("kernel", 0), "kernel"));
+    REQUIRE(!match(LevenshteinAutomaton("kernel", 0), "kernal"));
+    REQUIRE(match(LevenshteinAutomaton("kernel", 2), "kernals"));
+    // Characters, not bytes, are edited.
+    REQUIRE(match(LevenshteinAutomaton("smörgås", 1), "smorgås"));
+    REQUIRE(match(LevenshteinAutomaton("", 1), "a"));
+}
+
+TEST_CASE("levenshtein dead prefix", "[levenshtein]") {
+    const LevenshteinAutomaton automaton("kernel", 1);
+    size_t deadPrefix;
+    REQUIRE(!automaton.match("kxxnel", deadPrefix));
+    REQUIRE(deadPrefix == 3);
+    REQUIRE(!automaton.match("abc", deadPrefix));
+    REQUIRE(deadPrefix == 2);
+    REQUIRE(automaton.match("kernel", deadPrefix));
+    REQUIRE(deadPrefix == std::string::npos);
+    // Could still be extended to a match.
+    REQUIRE(!automaton.match("ker", deadPrefix));
+    REQUIRE(deadPrefix == std::string::npos);
+}
+
+TEST_CASE("levenshtein successor", "[levenshtein]") {
+    std::string next;
+    REQUIRE(LevenshteinAutomaton::successor("ab", next));
+    REQUIRE(next == "ac");
+    REQUIRE(LevenshteinAutomaton::successor("a\xc3\xbf", next));
+    REQUIRE(next == "a\xc4\x80");
+    REQUIRE(LevenshteinAutomaton::successor("a\xf4\x8f\xbf\xbf", next));
+    REQUIRE(next == "b");
+    REQUIRE(!LevenshteinAutomaton::successor("\xf4\x8f\xbf\xbf", next));
+}
@@ -0,0 +1,215 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "catch.hpp"
+#include "database.h"
+#include "options.h"
+#include "queryserver.h"
+
+namespace fs = boost::filesystem;
+using namespace Pdfsearch;
+
+static std::vector<QueryResult>
+query(QueryClient& client, const std::string& q, const QuerySettings& settings);
+
+static std::string
+request(const std::string& q);
+
+TEST_CASE("queryserver query", "[queryserver]") {
+    const std::string dbFile("./testdb");
+    const std::string socket("./test.sock");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+    db.createFullTextIndex();
+
+    QueryServer server(socket, dbFile, DatabaseSettings(), 2);
+    std::thread serving([&]() { server.run(); });
+
+    QuerySettings settings;
+    settings.verbose = true;
+    const auto& expected(db.query("unicode", settings));
+    REQUIRE(!expected.empty());
+    {
+        QueryClient client(socket);
+        // Clients are served at the same time.
+        QueryClient other(socket);
+        for (int i = 0; i < 2; i++) {
+            const auto& r(query(client, "unicode", settings));
+            REQUIRE(r.size() == expected.size());
+            for (size_t j = 0; j < r.size(); j++) {
+                REQUIRE(r[j].file == expected[j].file);
+                REQUIRE(r[j].page == expected[j].page);
+                REQUIRE(r[j].pages == expected[j].pages);
+                REQUIRE(r[j].chunk == expected[j].chunk);
+            }
+        }
+
+        settings.fullText = true;
+        settings.matches = 1;
+        REQUIRE(query(other, "unicode", settings).size() == 1);
+
+        // A failed query doesn't close the connection.
+        REQUIRE_THROWS_AS(query(client, "(unicode", settings),
+            std::runtime_error);
+        REQUIRE(query(client, "unicode", settings).size() == 1);
+    }
+
+    server.stop();
+    serving.join();
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("queryserver idle client", "[queryserver]") {
+    const std::string dbFile("./testdb");
+    const std::string socket("./test.sock");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+
+    // One job answers clients which stay connected in turns.
+    QueryServer server(socket, dbFile, DatabaseSettings(), 1);
+    std::thread serving([&]() { server.run(); });
+
+    QuerySettings settings;
+    const size_t expected = db.query("unicode", settings).size();
+    {
+        QueryClient idle(socket);
+        REQUIRE(query(idle, "unicode", settings).size() == expected);
+        for (int i = 0; i < 2; i++) {
+            QueryClient other(socket);
+            REQUIRE(query(other, "unicode", settings).size() == expected);
+        }
+        REQUIRE(query(idle, "unicode", settings).size() == expected);
+    }
+
+    server.stop();
+    serving.join();
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("queryserver client not reading", "[queryserver]") {
+    const std::string dbFile("./testdb");
+    const std::string socket("./test.sock");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+    std::vector<std::string> dirs{ "./pdfs/" };
+    db.index(dirs, Options::RECURSE_INFINITELY);
+
+    QueryServer server(socket, dbFile, DatabaseSettings(), 1);
+    std::thread serving([&]() { server.run(); });
+
+    // Requests are sent until the replies fill the socket and the only job
+    // can't send any more.
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket.c_str());
+    REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address)) == 0);
+    const std::string message(request("unicode"));
+    int blocked = 0;
+    while (blocked < 20) {
+        if (::send(fd, message.data(), message.size(), MSG_DONTWAIT) == -1) {
+            REQUIRE(errno == EAGAIN);
+            blocked++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        else
+            blocked = 0;
+    }
+
+    // The job doesn't wait for the client to read.
+    server.stop();
+    serving.join();
+    ::close(fd);
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("queryserver socket", "[queryserver]") {
+    const std::string dbFile("./testdb");
+    const std::string socket("./test.sock");
+    fs::remove(dbFile);
+    Database db(dbFile);
+    db.createDatabase();
+
+    // A socket nobody listens to is replaced.
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socket.c_str());
+    REQUIRE(::bind(fd, reinterpret_cast<sockaddr*>(&address),
+        sizeof(address)) == 0);
+    ::close(fd);
+    REQUIRE(fs::exists(socket));
+
+    {
+        QueryServer server(socket, dbFile, DatabaseSettings(), 1);
+        REQUIRE_THROWS_AS(QueryServer(socket, dbFile, DatabaseSettings(), 1),
+            std::system_error);
+    }
+    REQUIRE(!fs::exists(socket));
+    REQUIRE_THROWS_AS(QueryClient client(socket), std::system_error);
+
+    // A file which isn't a socket isn't removed.
+    std::ofstream(socket) << "notes";
+    REQUIRE_THROWS_AS(QueryServer(socket, dbFile, DatabaseSettings(), 1),
+        std::system_error);
+    REQUIRE(fs::file_size(socket) == 5);
+    fs::remove(socket);
+
+    fs::remove(dbFile);
+}
+
+static std::vector<QueryResult>
+query(QueryClient& client, const std::string& q,
+        const QuerySettings& settings) {
+    std::vector<QueryResult> results;
+    client.query(q, settings, [&](const QueryResult& r) {
+        results.push_back(r);
+    });
+
+    return results;
+}
+
+/* A request as QueryClient sends it, with default settings and verbose. */
+static std::string
+request(const std::string& q) {
+    std::string r;
+    auto appendInt = [&r](int32_t i) {
+        r.append(reinterpret_cast<const char*>(&i), sizeof(i));
+    };
+    QuerySettings settings;
+    appendInt(settings.matches);
+    appendInt(settings.fuzzy);
+    appendInt(settings.wordsBefore);
+    appendInt(settings.wordsAfter);
+    r += '\1';
+    appendInt(0);
+    r += q;
+
+    std::string message;
+    uint32_t length = r.size();
+    message.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    return message + r;
+}
@@ -0,0 +1,78 @@
+#include <string>
+#include <tuple>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+#include "catch.hpp"
+#include "resultrows.h"
+#include "database.h"
+#include "statement.h"
+#include "database_error.h"
+
+namespace fs = boost::filesystem;
+using namespace Pdfsearch;
+
+TEST_CASE("resultrows rows", "[resultrows]") {
+    std::string dbFile("./testdb");
+    Database db(dbFile);
+    db.createDatabase();
+
+    Statement insert(db, "insert into pdfs(file, last_modified) values(?1, ?2);");
+    for (int i = 1; i <= 3; i++) {
+        insert.bind(std::string(i, 'a'), 1);
+        insert.bind(i, 2);
+        insert.step();
+        insert.reset();
+    }
+
+    Statement s(db, "select file, last_modified from pdfs order by id;");
+    // Rows can be read again after the statement is reset.
+    for (int i = 0; i < 2; i++) {
+        int row = 1;
+        boost::string_view file;
+        int lastModified;
+        for (const auto& r : s.rows<boost::string_view, int>()) {
+            std::tie(file, lastModified) = r;
+            REQUIRE(file == std::string(row, 'a'));
+            REQUIRE(lastModified == row);
+            row++;
+        }
+        REQUIRE(row == 4);
+        s.reset();
+    }
+
+    Statement empty(db, "select file from pdfs where file = 'no file';");
+    const auto& rows(empty.rows<std::string>());
+    REQUIRE(rows.begin() == rows.end());
+
+    fs::remove(dbFile);
+}
+
+TEST_CASE("resultrows types", "[resultrows]") {
+    std::string dbFile("./testdb");
+    Database db(dbFile);
+    db.createDatabase();
+
+    Statement s(db, "select 5000000000, 0.5, 'a' || char(0) || 'b', null;");
+    const auto row(*s.rows<sqlite3_int64, double, std::string,
+        boost::optional<int>>().begin());
+    // Not truncated to int.
+    REQUIRE(std::get<0>(row) == 5000000000LL);
+    REQUIRE(std::get<1>(row) == 0.5);
+    REQUIRE(std::get<2>(row) == std::string("a\0b", 3));
+    REQUIRE(!std::get<3>(row));
+    s.reset();
+
+    // Wrong number of columns.
+    REQUIRE_THROWS_AS(s.rows<sqlite3_int64>(), DatabaseError);
+    // NULL needs an optional.
+    REQUIRE_THROWS_AS(
+        (s.rows<sqlite3_int64, double, std::string, int>().begin()),
+        DatabaseError);
+    s.reset();
+    REQUIRE_THROWS_AS(
+        (s.rows<sqlite3_int64, double, int, boost::optional<int>>().begin()),
+        DatabaseError);
+
+    fs::remove(dbFile);
+}
@@ -1,2 +1,10 @@
-#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_RUNNER
 #include "catch.hpp"
+#include "workerprocess.h"
+
+int
+main(int argc, char** argv) {
+    // Workers of the tests run this program again.
+    Pdfsearch::WorkerProcess::runIfWorker(argc, argv);
+    return Catch::Session().run(argc, argv);
+}